@@ -0,0 +1,138 @@
+#include "Battle.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+char const * const move_kind_names[Move::KindCount] = {
+	"attack",
+	"heal",
+	"drain",
+};
+
+//roll for crit and variance, then remove the damage from 'target':
+static void deal_damage(Move const &move, Combatant &target, float const rolls[MoveRolls], MoveResult *result) {
+	float damage = float(move.base_damage);
+
+	//check for crit:
+	if (rolls[1] < move.crit_chance) {
+		result->crit = true;
+		damage *= 2.0f;
+	}
+
+	//random damage variance:
+	damage *= 1.0f + Move::DamageVariance * (2.0f * rolls[2] - 1.0f);
+
+	result->damage = std::max(1, int(std::round(damage)));
+	target.cur_health -= result->damage;
+}
+
+//restore up to 'amount' health to 'user' (but not past max_health):
+static void restore_health(int amount, Combatant &user, MoveResult *result) {
+	result->healed = std::min(amount, std::max(0, user.max_health - user.cur_health));
+	user.cur_health += result->healed;
+}
+
+MoveEffect const move_effects[Move::KindCount] = {
+	//Attack:
+	[](Move const &move, Combatant &, Combatant &target, float const rolls[MoveRolls], MoveResult *result) {
+		deal_damage(move, target, rolls, result);
+	},
+	//Heal:
+	[](Move const &move, Combatant &user, Combatant &, float const [MoveRolls], MoveResult *result) {
+		restore_health(std::max(1, int(float(user.max_health) * move.percent_heal)), user, result);
+	},
+	//Drain:
+	[](Move const &move, Combatant &user, Combatant &target, float const rolls[MoveRolls], MoveResult *result) {
+		deal_damage(move, target, rolls, result);
+		restore_health(int(float(result->damage) * move.percent_heal), user, result);
+	},
+};
+
+MoveResult resolve_move(Move const &move, Combatant &user, Combatant &target, float const rolls[MoveRolls]) {
+	assert(move.kind < Move::KindCount);
+	MoveResult result;
+
+	//check if move lands:
+	if (rolls[0] >= move.accuracy) return result;
+	result.hit = true;
+
+	move_effects[move.kind](move, user, target, rolls, &result);
+
+	return result;
+}
+
+TurnResult resolve_turn(Combatant &a, uint32_t move_a, float const rolls_a[MoveRolls], Combatant &b, uint32_t move_b, float const rolls_b[MoveRolls]) {
+	assert(move_a < a.move_count);
+	assert(move_b < b.move_count);
+
+	TurnResult result;
+	result.a = resolve_move(a.moves[move_a], a, b, rolls_a);
+	result.b = resolve_move(b.moves[move_b], b, a, rolls_b);
+
+	bool a_down = (a.cur_health <= 0);
+	bool b_down = (b.cur_health <= 0);
+	if (a_down && b_down) result.outcome = TurnResult::Draw;
+	else if (b_down) result.outcome = TurnResult::AWins;
+	else if (a_down) result.outcome = TurnResult::BWins;
+
+	return result;
+}
+
+uint32_t Policy::choose(Combatant const &self, Combatant const &other, uint32_t turn, Random &rng) const {
+	assert(self.move_count != 0);
+	uint32_t count = self.move_count;
+
+	if (kind == Script && !script.empty()) {
+		return std::min(script[turn % script.size()], count - 1);
+	} else if (kind == Greedy) {
+		bool low = (self.cur_health * 3 < self.max_health);
+		uint32_t best = 0;
+		float best_value = -1.0f;
+		for (uint32_t i = 0; i < count; ++i) {
+			Move const &move = self.moves[i];
+			float hit = std::min(1.0f, move.accuracy);
+			float value = 0.0f;
+			if (move.kind == Move::Attack || move.kind == Move::Drain) {
+				value = hit * float(move.base_damage) * (1.0f + std::min(1.0f, move.crit_chance));
+			} else if (move.kind == Move::Heal && low) {
+				value = hit * float(self.max_health) * move.percent_heal;
+			}
+			if (value > best_value) {
+				best = i;
+				best_value = value;
+			}
+		}
+		return best;
+	} else {
+		return rng.below(count);
+	}
+}
+
+Policy Policy::parse(std::string const &str) {
+	Policy ret;
+	if (str == "random") {
+		ret.kind = Uniform;
+	} else if (str == "greedy") {
+		ret.kind = Greedy;
+	} else if (str.substr(0, 7) == "script:") {
+		ret.kind = Script;
+		std::string list = str.substr(7);
+		size_t begin = 0;
+		while (begin < list.size()) {
+			size_t end = list.find(',', begin);
+			if (end == std::string::npos) end = list.size();
+			std::string item = list.substr(begin, end - begin);
+			if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos) {
+				throw std::runtime_error("Expecting a comma-separated list of move indices in policy '" + str + "'.");
+			}
+			ret.script.emplace_back(uint32_t(std::stoul(item)));
+			begin = end + 1;
+		}
+		if (ret.script.empty()) throw std::runtime_error("Policy '" + str + "' has an empty script.");
+	} else {
+		throw std::runtime_error("Unknown policy '" + str + "'; expecting 'random', 'greedy', or 'script:i,j,...'.");
+	}
+	return ret;
+}
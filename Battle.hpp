@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+ * Battle rules, independent of input, drawing, and sound
+ * (so they can be run by PlayMode or, many times over, by battle-sim).
+ *
+ * A battle is a sequence of turns; each turn both combatants pick a move,
+ * the first combatant's move resolves, then the second's, then the battle checks for a winner.
+ *
+ */
+
+#include "Random.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Moves are plain data; what they do is decided by 'kind' (see move_effects, below):
+struct Move {
+	enum Kind : uint8_t {
+		Attack, //damage the target
+		Heal, //restore the user's health
+		Drain, //damage the target and restore some of the damage to the user
+		KindCount //<-- just used to size tables
+	};
+
+	std::string_view name = "placeholder move name"; //(usually points into BattleData's string table)
+	Kind kind = Attack;
+	float accuracy = 1.0f; //chance the move lands, in [0,1] (values above 1 always land)
+
+	//Attack, Drain:
+	uint32_t base_damage = 10;
+	float crit_chance = 0.1f; //chance of double damage
+	static constexpr float DamageVariance = 0.05f; //damage varies by up to +/- 5%
+
+	//Heal: fraction of max health restored; Drain: fraction of damage dealt restored
+	float percent_heal = 0.5f;
+};
+
+//names of move kinds, as used in character definition files ("attack", "heal", "drain"):
+extern char const * const move_kind_names[Move::KindCount];
+
+struct Combatant {
+	static constexpr int DefaultMaxHealth = 100;
+
+	std::string_view name;
+	Move const *moves = nullptr; //'move_count' moves, stored elsewhere (usually in BattleData), so copies are cheap
+	uint32_t move_count = 0;
+	int max_health = DefaultMaxHealth;
+	int cur_health = DefaultMaxHealth;
+};
+
+//what happened when a move was used:
+struct MoveResult {
+	bool hit = false;
+	bool crit = false;
+	int damage = 0; //health removed from target
+	int healed = 0; //health restored to user
+};
+
+//Every move consumes exactly MoveRolls uniform [0,1) floats, so rolls can be generated in batches:
+// rolls[0] decides hit, rolls[1] decides crit, rolls[2] decides damage variance.
+constexpr uint32_t MoveRolls = 3;
+
+//What a move does once it has landed, indexed by Move::Kind:
+// (a table of plain functions, so adding a kind of move is adding an entry, and moves stay plain data)
+typedef void (*MoveEffect)(Move const &move, Combatant &user, Combatant &target, float const rolls[MoveRolls], MoveResult *result);
+extern MoveEffect const move_effects[Move::KindCount];
+
+//Apply 'move' from 'user' to 'target':
+MoveResult resolve_move(Move const &move, Combatant &user, Combatant &target, float const rolls[MoveRolls]);
+
+struct TurnResult {
+	MoveResult a, b; //results of the first and second combatant's moves
+	enum Outcome : uint8_t {
+		Ongoing,
+		AWins,
+		BWins,
+		Draw
+	} outcome = Ongoing;
+};
+
+//Resolve one turn in which 'a' uses a.moves[move_a] and 'b' uses b.moves[move_b]:
+TurnResult resolve_turn(Combatant &a, uint32_t move_a, float const rolls_a[MoveRolls], Combatant &b, uint32_t move_b, float const rolls_b[MoveRolls]);
+
+//Policies pick moves for simulated combatants:
+struct Policy {
+	enum Kind : uint8_t {
+		Uniform, //uniformly random move
+		Greedy, //move with highest expected damage (or a heal, when low on health)
+		Script //repeat 'script' in order
+	} kind = Uniform;
+	std::vector< uint32_t > script;
+
+	uint32_t choose(Combatant const &self, Combatant const &other, uint32_t turn, Random &rng) const;
+
+	//parse "random", "greedy", or "script:0,1,1":
+	// (throws on anything else)
+	static Policy parse(std::string const &str);
+};
+
+struct BattleResult {
+	TurnResult::Outcome outcome = TurnResult::Draw;
+	uint32_t turns = 0;
+};
+
+//Run a battle between copies of 'a' and 'b' to completion (or 'max_turns', which counts as a draw);
+// each combatant rolls from its own generator, so one side's choices don't change the other's luck.
+// 'on_move' is called with (combatant index, move index, result) for every move:
+template< typename OnMove >
+BattleResult run_battle(Combatant a, Policy const &policy_a, Random &rng_a, Combatant b, Policy const &policy_b, Random &rng_b, uint32_t max_turns, OnMove &&on_move) {
+	//rolls are generated a batch of turns at a time:
+	constexpr uint32_t BatchTurns = 16;
+	float rolls_a[MoveRolls * BatchTurns];
+	float rolls_b[MoveRolls * BatchTurns];
+
+	BattleResult result;
+	for (uint32_t turn = 0; turn < max_turns; ++turn) {
+		uint32_t slot = turn % BatchTurns;
+		if (slot == 0) {
+			rng_a.fill_floats(rolls_a, MoveRolls * BatchTurns);
+			rng_b.fill_floats(rolls_b, MoveRolls * BatchTurns);
+		}
+		uint32_t move_a = policy_a.choose(a, b, turn, rng_a);
+		uint32_t move_b = policy_b.choose(b, a, turn, rng_b);
+		TurnResult t = resolve_turn(a, move_a, rolls_a + MoveRolls * slot, b, move_b, rolls_b + MoveRolls * slot);
+		on_move(0, move_a, t.a);
+		on_move(1, move_b, t.b);
+		result.turns = turn + 1;
+		if (t.outcome != TurnResult::Ongoing) {
+			result.outcome = t.outcome;
+			return result;
+		}
+	}
+	result.outcome = TurnResult::Draw;
+	return result;
+}
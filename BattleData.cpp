@@ -0,0 +1,61 @@
+#include "BattleData.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <stdexcept>
+
+BattleData::BattleData(std::string const &filename) : file(filename) {
+	ChunkReader chunks(file);
+
+	size_t character_count = 0, move_count = 0, string_count = 0;
+	CharacterEntry const *character_entries = chunks.view< CharacterEntry >(chunks.get("chr0"), &character_count);
+	MoveEntry const *move_entries = chunks.view< MoveEntry >(chunks.get("mov0"), &move_count);
+	char const *strings = chunks.view< char >(chunks.get("str0"), &string_count);
+
+	auto name = [&](uint32_t begin, uint32_t end) {
+		if (!(begin <= end && end <= string_count)) {
+			throw std::runtime_error("Battle data file '" + filename + "' has an out-of-range name begin/end.");
+		}
+		return std::string_view(strings + begin, end - begin);
+	};
+
+	moves.reserve(move_count);
+	for (size_t i = 0; i < move_count; ++i) {
+		MoveEntry const &entry = move_entries[i];
+		if (entry.kind >= Move::KindCount) {
+			throw std::runtime_error("Battle data file '" + filename + "' has a move of unknown kind " + std::to_string(entry.kind) + ".");
+		}
+		Move move;
+		move.name = name(entry.name_begin, entry.name_end);
+		move.kind = Move::Kind(entry.kind);
+		move.accuracy = entry.accuracy;
+		move.base_damage = entry.base_damage;
+		move.crit_chance = entry.crit_chance;
+		move.percent_heal = entry.percent_heal;
+		moves.emplace_back(move);
+	}
+
+	characters.reserve(character_count);
+	for (size_t i = 0; i < character_count; ++i) {
+		CharacterEntry const &entry = character_entries[i];
+		if (!(entry.move_begin < entry.move_end && entry.move_end <= move_count)) {
+			throw std::runtime_error("Battle data file '" + filename + "' has a character with an empty or out-of-range move list.");
+		}
+		if (entry.max_health <= 0) {
+			throw std::runtime_error("Battle data file '" + filename + "' has a character with non-positive max health.");
+		}
+		Combatant character;
+		character.name = name(entry.name_begin, entry.name_end);
+		character.moves = moves.data() + entry.move_begin;
+		character.move_count = entry.move_end - entry.move_begin;
+		character.max_health = character.cur_health = entry.max_health;
+		characters.emplace_back(character);
+	}
+}
+
+Combatant const &BattleData::lookup(std::string const &name) const {
+	for (auto const &character : characters) {
+		if (character.name == name) return character;
+	}
+	throw std::runtime_error("No character named '" + name + "' in battle data file '" + file.filename + "'.");
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * BattleData holds the move and character definitions used by the game and battle-sim.
+ *
+ * Definitions are written as text (see scenes/characters.txt) and compiled by
+ * compile-characters into a chunk file (see read_write_chunk.hpp):
+ *
+ *  "chr0": CharacterEntry[] -- name, max health, range of moves
+ *  "mov0": MoveEntry[]      -- name, kind, and parameters of every move, grouped by character
+ *  "str0": char[]           -- all names, concatenated
+ *  "crc0": checksums of the above (see ChunkWriter), checked on loading
+ *
+ * (the string chunk goes last so the fixed-size chunks stay 4-byte aligned)
+ *
+ * Loading maps the file once; names point into the mapping and all moves share one array.
+ *
+ */
+
+#include "Battle.hpp"
+#include "MappedFile.hpp"
+
+#include <string>
+#include <vector>
+
+struct BattleData {
+	//load compiled definitions from 'filename'; throws on malformed data:
+	explicit BattleData(std::string const &filename);
+
+	//no copying (moves and names point into owned storage):
+	BattleData(BattleData const &) = delete;
+	BattleData &operator=(BattleData const &) = delete;
+
+	//on-disk records:
+	struct CharacterEntry {
+		uint32_t name_begin, name_end;
+		int32_t max_health;
+		uint32_t move_begin, move_end;
+	};
+	static_assert(sizeof(CharacterEntry) == 20, "CharacterEntry is packed");
+
+	struct MoveEntry {
+		uint32_t name_begin, name_end;
+		uint32_t kind; //Move::Kind
+		float accuracy;
+		uint32_t base_damage;
+		float crit_chance;
+		float percent_heal;
+	};
+	static_assert(sizeof(MoveEntry) == 28, "MoveEntry is packed");
+
+	//characters at full health, ready to be copied into a battle:
+	std::vector< Combatant > characters;
+	std::vector< Move > moves; //every character's moves
+
+	//look up a character by name; throws if it doesn't exist:
+	Combatant const &lookup(std::string const &name) const;
+
+	MappedFile file;
+};
@@ -0,0 +1,252 @@
+#include "ClusteredLights.hpp"
+
+#include "ShadowMaps.hpp"
+#include "UniformBlocks.hpp"
+#include "gl_errors.hpp"
+#include "gl_stats.hpp"
+#include "Jobs.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//light type numbers, as used by lit_color_texture.fs:
+static float shader_light_type(Scene::Light::Type type) {
+	if (type == Scene::Light::Point) return 0.0f;
+	if (type == Scene::Light::Hemisphere) return 1.0f;
+	if (type == Scene::Light::Spot) return 2.0f;
+	return 3.0f; //Directional
+}
+
+float light_range(Scene::Light const &light, float min_energy) {
+	if (light.distance > 0.0f) return light.distance;
+	float energy = std::max(light.energy.r, std::max(light.energy.g, light.energy.b));
+	return std::sqrt(std::max(energy, 0.0f) / min_energy);
+}
+
+//make a buffer and a texture viewing it as 'format':
+static void make_texture_buffer(GLenum format, GLuint *buffer, GLuint *texture) {
+	glGenBuffers(1, buffer);
+	glGenTextures(1, texture);
+	glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW); //(never empty, so the texture is always valid)
+	glBindTexture(GL_TEXTURE_BUFFER, *texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+//replace a texture buffer's contents (orphaning the old storage so the GPU needn't be waited on):
+template< typename T >
+static void upload_texture_buffer(GLuint buffer, std::vector< T > const &data) {
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	GLsizeiptr size = std::max(GLsizeiptr(16), GLsizeiptr(data.size() * sizeof(T)));
+	glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	if (!data.empty()) glBufferSubData(GL_TEXTURE_BUFFER, 0, data.size() * sizeof(T), data.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+ClusteredLights::ClusteredLights() {
+	make_texture_buffer(GL_RGBA32F, &lights_buffer, &lights_texture);
+	make_texture_buffer(GL_RG32UI, &clusters_buffer, &clusters_texture);
+	make_texture_buffer(GL_R32UI, &indices_buffer, &indices_texture);
+	slice_indices.resize(Slices);
+	GL_ERRORS();
+}
+
+ClusteredLights::~ClusteredLights() {
+	GLuint buffers[3] = {lights_buffer, clusters_buffer, indices_buffer};
+	glDeleteBuffers(3, buffers);
+	GLuint textures[3] = {lights_texture, clusters_texture, indices_texture};
+	glDeleteTextures(3, textures);
+}
+
+void ClusteredLights::update(std::list< Scene::Light > const &lights, Scene::Camera const &camera, glm::uvec2 const &drawable_size, ShadowMaps const *shadows) {
+	PROFILE_SCOPE("ClusteredLights::update");
+	assert(camera.transform);
+
+	glm::mat4x3 world_to_view = camera.transform->make_world_to_local();
+
+	//------ light list ------
+	// (global lights first, then the local lights that get binned)
+
+	//view-space bounds of each local light:
+	struct Bounds {
+		glm::vec2 center; //view-space x,y
+		float depth; //view-space -z
+		float radius;
+		uint32_t slice_begin, slice_end; //slices touched: [begin,end)
+	};
+	std::vector< Bounds > bounds;
+
+	float const slice_scale = float(Slices) / std::log(slice_far / slice_near);
+	float const slice_bias = -std::log(slice_near) * slice_scale;
+	auto slice_of = [&](float depth) {
+		float s = std::floor(std::log(std::max(depth, 1e-6f)) * slice_scale + slice_bias);
+		return uint32_t(std::min(std::max(s, 0.0f), float(Slices - 1)));
+	};
+
+	light_texels.clear();
+	auto append = [&](Scene::Light const &light, float range) {
+		glm::mat4x3 light_to_world = light.transform->make_local_to_world();
+		glm::vec3 position = light_to_world[3];
+		glm::vec3 direction = -glm::normalize(light_to_world[2]);
+		light_texels.emplace_back(position, shader_light_type(light.type));
+		light_texels.emplace_back(direction, std::cos(0.5f * light.spot_fov));
+		light_texels.emplace_back(light.energy, range);
+		glm::uvec2 layers = (shadows ? shadows->layers_of(&light) : glm::uvec2(0));
+		light_texels.emplace_back(float(layers.x), float(layers.y), 0.0f, 0.0f);
+	};
+
+	global_count = 0;
+	for (auto const &light : lights) {
+		if (light.type != Scene::Light::Hemisphere && light.type != Scene::Light::Directional) continue;
+		append(light, 0.0f);
+		global_count += 1;
+	}
+
+	local_count = 0;
+	for (auto const &light : lights) {
+		if (light.type == Scene::Light::Hemisphere || light.type == Scene::Light::Directional) continue;
+
+		float range = light_range(light, min_energy);
+		if (!(range > 0.0f)) continue;
+
+		//(spot lights are bounded by their whole sphere; a cone test would bin fewer clusters)
+		glm::vec3 center = world_to_view * glm::vec4(glm::vec3(light.transform->make_local_to_world()[3]), 1.0f);
+		Bounds b;
+		b.center = glm::vec2(center);
+		b.depth = -center.z;
+		b.radius = range;
+		if (b.depth + b.radius < camera.near) continue; //entirely behind the camera
+		b.slice_begin = slice_of(std::max(b.depth - b.radius, camera.near));
+		b.slice_end = slice_of(b.depth + b.radius) + 1;
+
+		append(light, range);
+		bounds.emplace_back(b);
+		local_count += 1;
+	}
+
+	//------ bin local lights into clusters ------
+	// (each slice is independent, so slices are binned in parallel into their own lists)
+
+	cluster_ranges.assign(ClusterCount, glm::uvec2(0));
+
+	//projection scale, so that ndc.x = x_scale * x / depth (and the same for y):
+	float const y_scale = 1.0f / std::tan(0.5f * camera.fovy);
+	float const x_scale = y_scale / camera.aspect;
+
+	auto bin_slice = [&](uint32_t s) {
+		std::vector< uint32_t > &indices = slice_indices[s];
+		indices.clear();
+		glm::uvec2 *ranges = &cluster_ranges[s * TilesX * TilesY];
+
+		//depths covered by this slice (the first and last extend to the camera and to infinity):
+		float const slice_min = (s == 0 ? camera.near : std::exp((float(s) - slice_bias) / slice_scale));
+		float const slice_max = (s + 1 == Slices ? std::numeric_limits< float >::infinity() : std::exp((float(s + 1) - slice_bias) / slice_scale));
+
+		//tile rectangle each light covers in this slice:
+		struct Rect {
+			uint32_t light;
+			glm::uvec2 min, max; //inclusive
+		};
+		std::vector< Rect > rects;
+		for (uint32_t i = 0; i < uint32_t(bounds.size()); ++i) {
+			Bounds const &b = bounds[i];
+			if (s < b.slice_begin || s >= b.slice_end) continue;
+			float d0 = std::max(std::max(slice_min, camera.near), b.depth - b.radius);
+			float d1 = std::min(slice_max, b.depth + b.radius);
+
+			//(conservative: the sphere's view-space box, projected from whichever depth makes it widest)
+			auto tile_range = [&](float lo, float hi, float scale, uint32_t tiles) {
+				float ndc_lo = scale * lo / (lo < 0.0f ? d0 : d1);
+				float ndc_hi = scale * hi / (hi > 0.0f ? d0 : d1);
+				float t_lo = std::floor((ndc_lo * 0.5f + 0.5f) * float(tiles));
+				float t_hi = std::floor((ndc_hi * 0.5f + 0.5f) * float(tiles));
+				return glm::ivec2(
+					int32_t(std::min(std::max(t_lo, 0.0f), float(tiles))),
+					int32_t(std::min(std::max(t_hi, -1.0f), float(tiles - 1)))
+				);
+			};
+			glm::ivec2 x = tile_range(b.center.x - b.radius, b.center.x + b.radius, x_scale, TilesX);
+			glm::ivec2 y = tile_range(b.center.y - b.radius, b.center.y + b.radius, y_scale, TilesY);
+			if (x.x > x.y || y.x > y.y) continue; //off screen
+
+			rects.emplace_back(Rect{global_count + i, glm::uvec2(x.x, y.x), glm::uvec2(x.y, y.y)});
+			for (uint32_t ty = y.x; ty <= uint32_t(y.y); ++ty) {
+				for (uint32_t tx = x.x; tx <= uint32_t(x.y); ++tx) {
+					ranges[ty * TilesX + tx].y += 1;
+				}
+			}
+		}
+
+		//lay out each cluster's list (offsets are within this slice for now):
+		uint32_t total = 0;
+		for (uint32_t t = 0; t < TilesX * TilesY; ++t) {
+			ranges[t].x = total;
+			total += ranges[t].y;
+			ranges[t].y = 0;
+		}
+		indices.resize(total);
+		for (Rect const &r : rects) {
+			for (uint32_t ty = r.min.y; ty <= r.max.y; ++ty) {
+				for (uint32_t tx = r.min.x; tx <= r.max.x; ++tx) {
+					glm::uvec2 &range = ranges[ty * TilesX + tx];
+					indices[range.x + range.y] = r.light;
+					range.y += 1;
+				}
+			}
+		}
+	};
+
+	{
+		PROFILE_SCOPE("bin");
+		//(with only a few lights, binning a slice is quicker than handing it to another thread)
+		Jobs::parallel_for(Slices, (local_count >= 32 ? 1 : Slices), [&](uint32_t begin, uint32_t end) {
+			for (uint32_t s = begin; s < end; ++s) bin_slice(s);
+		});
+	}
+
+	//concatenate the slice lists:
+	index_count = 0;
+	for (uint32_t s = 0; s < Slices; ++s) index_count += uint32_t(slice_indices[s].size());
+	light_indices.resize(index_count);
+	{
+		uint32_t offset = 0;
+		for (uint32_t s = 0; s < Slices; ++s) {
+			std::copy(slice_indices[s].begin(), slice_indices[s].end(), light_indices.begin() + offset);
+			for (uint32_t t = 0; t < TilesX * TilesY; ++t) {
+				cluster_ranges[s * TilesX * TilesY + t].x += offset;
+			}
+			offset += uint32_t(slice_indices[s].size());
+		}
+	}
+
+	//------ upload ------
+
+	upload_texture_buffer(lights_buffer, light_texels);
+	upload_texture_buffer(clusters_buffer, cluster_ranges);
+	upload_texture_buffer(indices_buffer, light_indices);
+
+	//(these units are above the ones Scene::draw binds per-drawable, so they stay bound through the scene)
+	GLuint const units[3] = {LightsTextureUnit, ClustersTextureUnit, LightIndicesTextureUnit};
+	GLuint const textures[3] = {lights_texture, clusters_texture, indices_texture};
+	for (uint32_t i = 0; i < 3; ++i) {
+		glActiveTexture(GL_TEXTURE0 + units[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	gl_stats.state_changes += 3;
+
+	frame_block.WORLD_TO_VIEW = glm::mat4(world_to_view);
+	frame_block.CLUSTER_SCALE = glm::vec4(
+		float(TilesX) / float(std::max(1U, drawable_size.x)),
+		float(TilesY) / float(std::max(1U, drawable_size.y)),
+		slice_scale,
+		slice_bias
+	);
+	frame_block.CLUSTER_COUNT = glm::ivec4(TilesX, TilesY, Slices, global_count);
+
+	GL_ERRORS();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * ClusteredLights bins a scene's lights into a grid of view-space
+ * clusters (screen tiles x exponential depth slices) so that
+ * LitColorTextureProgram shades each fragment with only the lights
+ * that can reach its cluster.
+ *
+ * Each frame, update() bins the lights on the CPU (slices in parallel),
+ * uploads three texture buffers, binds them to the texture units below,
+ * and writes the grid parameters into frame_block (UniformBlocks.hpp).
+ *
+ * Hemisphere and directional lights reach everything, so they are
+ * stored first in the light list and applied to every fragment.
+ *
+ * Lighting is done in world space, so draw with Scene::draw(camera)
+ * (where light space == world space).
+ *
+ */
+
+#include "GL.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <list>
+#include <vector>
+
+struct ShadowMaps;
+
+//texture units the light lists are bound to (just above the Scene::Drawable::Pipeline textures):
+constexpr GLuint LightsTextureUnit = Scene::Drawable::Pipeline::TextureCount + 0; //LIGHTS: 4 RGBA32F texels per light
+constexpr GLuint ClustersTextureUnit = Scene::Drawable::Pipeline::TextureCount + 1; //CLUSTERS: RG32UI (first index, count) per cluster
+constexpr GLuint LightIndicesTextureUnit = Scene::Drawable::Pipeline::TextureCount + 2; //LIGHT_INDICES: R32UI light index
+
+//how far a point or spot light reaches: its own distance if set, otherwise where its brightest channel falls to min_energy:
+float light_range(Scene::Light const &light, float min_energy);
+
+struct ClusteredLights {
+	ClusteredLights();
+	~ClusteredLights();
+	ClusteredLights(ClusteredLights const &) = delete;
+	ClusteredLights &operator=(ClusteredLights const &) = delete;
+
+	enum : uint32_t {
+		TilesX = 16,
+		TilesY = 9,
+		Slices = 24,
+		ClusterCount = TilesX * TilesY * Slices
+	};
+
+	//depths (view space, positive) spanned by the exponential slices;
+	// nearer fragments use the first slice, farther ones the last:
+	float slice_near = 0.1f;
+	float slice_far = 100.0f;
+
+	//point and spot lights with no distance set reach until their energy falls below this:
+	float min_energy = 1.0f / 64.0f;
+
+	//bin 'lights' as seen by 'camera' into a drawable_size framebuffer:
+	// (lights with maps in 'shadows', if given, are shadowed)
+	void update(std::list< Scene::Light > const &lights, Scene::Camera const &camera, glm::uvec2 const &drawable_size, ShadowMaps const *shadows = nullptr);
+
+	//counts from the last update() (for stats display):
+	uint32_t global_count = 0; //lights applied to every fragment
+	uint32_t local_count = 0; //lights binned into clusters
+	uint32_t index_count = 0; //total entries in all cluster lists
+
+	//GL objects (buffer + texture for each list):
+	GLuint lights_buffer = 0, lights_texture = 0;
+	GLuint clusters_buffer = 0, clusters_texture = 0;
+	GLuint indices_buffer = 0, indices_texture = 0;
+
+	//CPU-side lists (kept between frames to reuse their storage):
+	std::vector< glm::vec4 > light_texels;
+	std::vector< glm::uvec2 > cluster_ranges;
+	std::vector< uint32_t > light_indices;
+	std::vector< std::vector< uint32_t > > slice_indices; //per-slice lists, concatenated into light_indices
+};
@@ -39,7 +39,7 @@ ColorProgram::ColorProgram() {
 }
 
 ColorProgram::~ColorProgram() {
-	glDeleteProgram(program);
+	gl_release_program(program);
 	program = 0;
 }
 
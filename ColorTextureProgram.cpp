@@ -53,7 +53,7 @@ ColorTextureProgram::ColorTextureProgram() {
 }
 
 ColorTextureProgram::~ColorTextureProgram() {
-	glDeleteProgram(program);
+	gl_release_program(program);
 	program = 0;
 }
 
@@ -0,0 +1,37 @@
+#include "DepthProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+#include "UniformBlocks.hpp"
+
+Load< DepthProgram > depth_program(LoadTagEarly);
+
+DepthProgram::DepthProgram() {
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"layout(std140) uniform Object {\n"
+		"	mat4 OBJECT_TO_CLIP;\n"
+		"	mat4 OBJECT_TO_LIGHT;\n"
+		"	mat3 NORMAL_TO_LIGHT;\n"
+		"};\n"
+		"layout(location = 0) in vec4 Position;\n"
+		"invariant gl_Position;\n" //(so pre-pass depths match lit_color_texture.vs exactly)
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
+		"}\n"
+	,
+		//fragment shader:
+		// (no outputs -- depth is written by fixed-function)
+		"#version 330\n"
+		"void main() {\n"
+		"}\n"
+	);
+
+	bind_uniform_blocks(program);
+}
+
+DepthProgram::~DepthProgram() {
+	gl_release_program(program);
+	program = 0;
+}
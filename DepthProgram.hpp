@@ -0,0 +1,22 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that only writes depth (for shadow maps and depth pre-passes):
+// reads OBJECT_TO_CLIP from the "Object" uniform block and Position from attribute location 0,
+// so it can draw with the vertex arrays made for any program that does the same (see Scene::draw_depth).
+struct DepthProgram {
+	DepthProgram();
+	~DepthProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Position_vec4 = 0; //(fixed)
+	//Uniforms:
+	//"Object" block (only OBJECT_TO_CLIP is used)
+	//Textures:
+	// none
+};
+
+extern Load< DepthProgram > depth_program;
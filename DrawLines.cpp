@@ -1,74 +1,137 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
-#include "ColorProgram.hpp"
+#include "ThickLinesProgram.hpp"
 
 #include "gl_errors.hpp"
+#include "gl_stats.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <unordered_map>
+
 //All DrawLines instances share a vertex array object and vertex buffer, initialized at load time:
 
 //n.b. declared static so they don't conflict with similarly named global variables elsewhere:
-static GLuint vertex_buffer = 0;
-static GLuint vertex_buffer_for_color_program = 0;
+static GLuint segment_buffer = 0;
+static GLuint segment_buffer_for_thick_lines_program = 0;
+
+//builds a vertex array object that reads DrawLines::Segment instances from 'buffer' for thick_lines_program:
+static GLuint make_vao_for_thick_lines_program(GLuint buffer) {
+	//ask OpenGL to fill vao with the name of an unused vertex array object:
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+
+	//set vao as the current vertex array object:
+	glBindVertexArray(vao);
+
+	//set buffer as the source of glVertexAttribPointer() commands:
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	//set up the vertex array object to describe arrays of DrawLines::Segment:
+	auto bind_attribute = [](GLuint location, GLint size, GLenum type, GLboolean normalized, size_t offset) {
+		glVertexAttribPointer(
+			location, //attribute
+			size, //size
+			type, //type
+			normalized, //normalized
+			sizeof(DrawLines::Segment), //stride
+			(GLbyte *)0 + offset //offset
+		);
+		glEnableVertexAttribArray(location);
+		//advance once per instance (i.e., per segment) rather than once per vertex:
+		glVertexAttribDivisor(location, 1);
+	};
+	bind_attribute(thick_lines_program->A_vec3, 3, GL_FLOAT, GL_FALSE, offsetof(DrawLines::Segment, A));
+	bind_attribute(thick_lines_program->B_vec3, 3, GL_FLOAT, GL_FALSE, offsetof(DrawLines::Segment, B));
+	bind_attribute(thick_lines_program->Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(DrawLines::Segment, Color));
+	bind_attribute(thick_lines_program->Width_float, 1, GL_FLOAT, GL_FALSE, offsetof(DrawLines::Segment, Width));
+
+	//done referring to buffer, so unbind it:
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//done setting up vertex array object, so unbind it:
+	glBindVertexArray(0);
+
+	return vao;
+}
 
 static Load< void > setup_buffers(LoadTagDefault, [](){
 	//you may recognize this init code from DrawSprites.cpp:
 
-	{ //set up vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
+	{ //set up segment buffer:
+		glGenBuffers(1, &segment_buffer);
 		//for now, buffer will be un-filled.
 	}
 
-	{ //vertex array mapping buffer for color_program:
-		//ask OpenGL to fill vertex_buffer_for_color_program with the name of an unused vertex array object:
-		glGenVertexArrays(1, &vertex_buffer_for_color_program);
+	{ //vertex array mapping segment_buffer for thick_lines_program:
+		segment_buffer_for_thick_lines_program = make_vao_for_thick_lines_program(segment_buffer);
+	}
 
-		//set vertex_buffer_for_color_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_program);
+	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
+});
 
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+//draws 'count' segments from 'vao' using thick_lines_program:
+// (leaves blending as it was when 'lines' was constructed)
+static void draw_segments(GLuint vao, GLsizei count, glm::mat4 const &object_to_clip, DrawLines const &lines) {
+	//set thick_lines_program as current program:
+	glUseProgram(thick_lines_program->program);
 
-		//set up the vertex array object to describe arrays of PongMode::Vertex:
-		glVertexAttribPointer(
-			color_program->Position_vec4, //attribute
-			3, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(DrawLines::Vertex), //stride
-			(GLbyte *)0 + offsetof(DrawLines::Vertex, Position) //offset
-		);
-		glEnableVertexAttribArray(color_program->Position_vec4);
-		//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
+	//upload OBJECT_TO_CLIP to the proper uniform location:
+	glUniformMatrix4fv(thick_lines_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
 
-		glVertexAttribPointer(
-			color_program->Color_vec4, //attribute
-			4, //size
-			GL_UNSIGNED_BYTE, //type
-			GL_TRUE, //normalized
-			sizeof(DrawLines::Vertex), //stride
-			(GLbyte *)0 + offsetof(DrawLines::Vertex, Color) //offset
-		);
-		glEnableVertexAttribArray(color_program->Color_vec4);
+	//line widths are in pixels, so the shader needs to know the viewport size:
+	glUniform2f(thick_lines_program->VIEWPORT_SIZE_vec2, lines.viewport_size.x, lines.viewport_size.y);
+	gl_stats.uniform_uploads += 2;
 
-		//done referring to vertex_buffer, so unbind it:
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//antialiasing writes partial coverage to alpha, so blending must be on:
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		//done setting up vertex array object, so unbind it:
-		glBindVertexArray(0);
-	}
+	//use the mapping in vao to fetch segment data:
+	glBindVertexArray(vao);
 
-	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
-});
+	//run the OpenGL pipeline -- one four-vertex strip per segment:
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+	gl_stats.draw_calls += 1;
+	gl_stats.vertices += 4 * count;
+	gl_stats.state_changes += 2; //(program + vertex array)
+
+	//reset vertex array to none:
+	glBindVertexArray(0);
 
+	//put back the blend state captured by the DrawLines constructor:
+	glBlendFuncSeparate(lines.blend.src_rgb, lines.blend.dst_rgb, lines.blend.src_alpha, lines.blend.dst_alpha);
+	if (!lines.blend.enabled) glDisable(GL_BLEND);
+
+	//reset current program to none:
+	glUseProgram(0);
+}
+
+//Retained batches each own a vertex buffer (and vertex array object) that persist between frames:
+struct RetainedBatch {
+	GLuint buffer = 0;
+	GLuint vao = 0;
+	GLsizei count = 0; //number of segments in buffer
+	size_t content_hash = 0; //hash passed to draw_retained() when buffer was recorded
+	bool recorded = false;
+};
+static std::unordered_map< std::string, RetainedBatch > retained_batches;
 
 DrawLines::DrawLines(glm::mat4 const &world_to_clip_) : world_to_clip(world_to_clip_) {
+	//read back viewport and blend state once here, rather than on every draw:
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	viewport_size = glm::vec2(float(viewport[2]), float(viewport[3]));
+
+	blend.enabled = (glIsEnabled(GL_BLEND) == GL_TRUE);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blend.src_rgb);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blend.dst_rgb);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend.src_alpha);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blend.dst_alpha);
 }
 
 void DrawLines::draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &color) {
-	attribs.emplace_back(a, color);
-	attribs.emplace_back(b, color);
+	segments.emplace_back(a, b, color, width);
 }
 
 void DrawLines::draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color) {
@@ -94,71 +157,91 @@ void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, g
 
 	glm::vec3 anchor = anchor_in;
 
-	uint32_t start = 0;
-	while (start < text.size()) {
-		uint32_t end = start;
+	char const *start = text.data();
+	char const *text_end = text.data() + text.size();
+	while (start < text_end) {
 		uint32_t glyph = -1U;
-		while (end < text.size()) {
-			end += 1;
-			auto f = PathFont::font.glyph_map.find(text.substr(start, end-start));
-			if (f == PathFont::font.glyph_map.end()) {
-				end -= 1;
-				break;
-			}
-			glyph = f->second;
-		}
+		uint32_t length = PathFont::font.match(start, text_end, &glyph);
 		if (glyph == -1U) {
-			assert(start == end);
-			end += 1;
+			assert(length == 0);
+			length = 1;
 			//missing! draw a tofu:
-			for (const auto &pt : {
+			static const glm::vec2 tofu[8] = {
 				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
 				glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
 				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
 				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
-			}) {
-				attribs.emplace_back(anchor + pt.x * x + pt.y * y, color);
+			};
+			for (uint32_t i = 0; i + 1 < 8; i += 2) {
+				draw(anchor + tofu[i].x * x + tofu[i].y * y, anchor + tofu[i+1].x * x + tofu[i+1].y * y, color);
 			}
 			anchor += x * 0.6f;
 		} else {
-			for (uint32_t c = PathFont::font.glyph_coord_starts[glyph]; c + 1 < PathFont::font.glyph_coord_starts[glyph+1]; c += 2) {
-				attribs.emplace_back(anchor + x * PathFont::font.coords[c] + y * PathFont::font.coords[c+1], color);
+			//coords are (x,y) pairs, two per segment:
+			for (uint32_t c = PathFont::font.glyph_coord_starts[glyph]; c + 3 < PathFont::font.glyph_coord_starts[glyph+1]; c += 4) {
+				draw(
+					anchor + x * PathFont::font.coords[c] + y * PathFont::font.coords[c+1],
+					anchor + x * PathFont::font.coords[c+2] + y * PathFont::font.coords[c+3],
+					color
+				);
 			}
 			anchor += x * PathFont::font.glyph_widths[glyph];
 		}
-		start = end;
+		start += length;
 	}
 
 	if (anchor_out) *anchor_out = anchor;
 }
 
-DrawLines::~DrawLines() {
-	if (attribs.empty()) return;
-
-	//based on DrawSprites.cpp :
+void DrawLines::draw_retained(std::string const &name, size_t content_hash, std::function< void(DrawLines &) > const &record, glm::mat4x3 const &object_to_world) {
+	auto f = retained_batches.find(name);
+	if (f == retained_batches.end()) {
+		f = retained_batches.emplace(name, RetainedBatch()).first;
+		glGenBuffers(1, &f->second.buffer);
+		f->second.vao = make_vao_for_thick_lines_program(f->second.buffer);
+	}
+	RetainedBatch &batch = f->second;
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STREAM_DRAW); //upload attribs array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//(re-)record batch only if contents have changed:
+	if (!batch.recorded || batch.content_hash != content_hash) {
+		DrawLines recorder(world_to_clip);
+		recorder.width = width;
+		record(recorder);
 
-	//set color_program as current program:
-	glUseProgram(color_program->program);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+		glBufferData(GL_ARRAY_BUFFER, recorder.segments.size() * sizeof(Segment), recorder.segments.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	//upload OBJECT_TO_CLIP to the proper uniform location:
-	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+		batch.count = GLsizei(recorder.segments.size());
+		batch.content_hash = content_hash;
+		batch.recorded = true;
 
-	//use the mapping vertex_buffer_for_color_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_program);
+		//lines now live in batch.buffer, so don't also draw them from recorder's destructor:
+		recorder.segments.clear();
+	}
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_LINES, 0, GLsizei(attribs.size()));
+	if (batch.count == 0) return;
 
-	//reset vertex array to none:
-	glBindVertexArray(0);
+	draw_segments(batch.vao, batch.count, world_to_clip * glm::mat4(object_to_world), *this);
+}
 
-	//reset current program to none:
-	glUseProgram(0);
+void DrawLines::forget_retained(std::string const &name) {
+	auto f = retained_batches.find(name);
+	if (f == retained_batches.end()) return;
+	glDeleteVertexArrays(1, &f->second.vao);
+	glDeleteBuffers(1, &f->second.buffer);
+	retained_batches.erase(f);
 }
 
+DrawLines::~DrawLines() {
+	if (segments.empty()) return;
+
+	//based on DrawSprites.cpp :
 
+	//upload segments to segment_buffer:
+	glBindBuffer(GL_ARRAY_BUFFER, segment_buffer); //set segment_buffer as current
+	glBufferData(GL_ARRAY_BUFFER, segments.size() * sizeof(segments[0]), segments.data(), GL_STREAM_DRAW); //upload segments array
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	draw_segments(segment_buffer_for_thick_lines_program, GLsizei(segments.size()), world_to_clip, *this);
+}
@@ -6,18 +6,28 @@
  *
  * Similar usage pattern to DrawSprites.
  *
+ * Lines are drawn as antialiased screen-space quads (see ThickLinesProgram),
+ * so they can be wider than the one pixel GL_LINES allows on core profiles.
+ * Each line is stored as a single Segment, which is drawn as one instance.
+ *
  */
 
 
 #include <glm/glm.hpp>
 
+#include <functional>
 #include <string>
 #include <vector>
 
 struct DrawLines {
 	//Start drawing; will remember world_to_clip matrix:
+	// (also remembers the current viewport size and blend state -- lines are drawn with
+	//  alpha blending, and blending is put back to this state after each draw)
 	DrawLines(glm::mat4 const &world_to_clip);
 
+	//width (in pixels) used for lines drawn by subsequent draw / draw_box / draw_text calls:
+	float width = 1.0f;
+
 	//draw a single line from a to b (in world space):
 	void draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &color = glm::u8vec4(0xff));
 
@@ -33,16 +43,37 @@ struct DrawLines {
 		glm::u8vec4 const &color = glm::u8vec4(0xff),
 		glm::vec3 *anchor_out = nullptr);
 
+	//Retained drawing -- for overlays (labels, boxes) that rarely change:
+	// lines are recorded into a named batch that keeps its own vertex buffer across frames.
+	// 'record' is called (with a fresh DrawLines) only when 'content_hash' differs from the hash
+	// the batch was last recorded with; otherwise the stored buffer is drawn again with only
+	// the matrix updated. (e.g., use std::hash< std::string > of the label text as the hash)
+	//NOTE: retained batches are drawn immediately, not when this DrawLines is destroyed.
+	void draw_retained(std::string const &name, size_t content_hash,
+		std::function< void(DrawLines &) > const &record,
+		glm::mat4x3 const &object_to_world = glm::mat4x3(1.0f));
+
+	//free the vertex buffer held by a retained batch (it will be re-recorded if drawn again):
+	static void forget_retained(std::string const &name);
+
 	//Finish drawing (push attribs to GPU):
 	~DrawLines();
 
 
 	glm::mat4 world_to_clip;
-	struct Vertex {
-		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_) : Position(Position_), Color(Color_) { }
-		glm::vec3 Position;
+	glm::vec2 viewport_size; //pixels; line widths are measured against this
+	struct {
+		bool enabled;
+		int src_rgb, dst_rgb, src_alpha, dst_alpha; //(GLint values)
+	} blend; //blend state to leave behind after drawing
+	struct Segment {
+		Segment(glm::vec3 const &A_, glm::vec3 const &B_, glm::u8vec4 const &Color_, float Width_) : A(A_), B(B_), Color(Color_), Width(Width_) { }
+		glm::vec3 A;
+		glm::vec3 B;
 		glm::u8vec4 Color;
+		float Width;
 	};
-	std::vector< Vertex > attribs;
+	static_assert(sizeof(Segment) == 3*4 + 3*4 + 4*1 + 4, "Segment is packed.");
+	std::vector< Segment > segments;
 
 };
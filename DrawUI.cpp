@@ -0,0 +1,169 @@
+#include "DrawUI.hpp"
+
+#include "GL.hpp"
+#include "Load.hpp"
+#include "data_path.hpp"
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+#include "gl_stats.hpp"
+#include "HotReload.hpp"
+#include "Profiler.hpp"
+#include "shader.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+//text program (source in dist/text.vs and dist/text.fs); attribute 0 is Position+TexCoord, attribute 1 is Color:
+static Load< Shader > text_shader(LoadTagEarly, []() -> Shader const * {
+	return new Shader(data_path("text.vs").c_str(), data_path("text.fs").c_str());
+});
+
+//uniform locations in text_shader, looked up once at load time:
+static GLint text_shader_projection = -1;
+
+//All DrawUI instances share a vertex array object and vertex buffer, initialized at load time:
+//n.b. declared static so they don't conflict with similarly named global variables elsewhere:
+static GLuint vertex_buffer = 0;
+static GLuint vertex_buffer_for_text_shader = 0;
+
+//(also called after text_shader is relinked by a hot reload)
+static void find_text_shader_uniforms() {
+	text_shader_projection = glGetUniformLocation(text_shader->ID, "projection");
+
+	//glyphs are always read from texture unit zero:
+	glUseProgram(text_shader->ID);
+	glUniform1i(glGetUniformLocation(text_shader->ID, "text"), 0);
+	glUseProgram(0);
+}
+
+static Load< void > setup_buffers(LoadTagDefault, [](){
+	find_text_shader_uniforms();
+
+	HotReload::watch({data_path("text.vs"), data_path("text.fs")}, []() -> HotReload::Commit {
+		std::string vs = HotReload::read_file(data_path("text.vs"));
+		std::string fs = HotReload::read_file(data_path("text.fs"));
+		return [vs, fs](){
+			gl_relink_program(text_shader->ID, vs, fs);
+			find_text_shader_uniforms();
+		};
+	});
+
+	glGenBuffers(1, &vertex_buffer);
+
+	glGenVertexArrays(1, &vertex_buffer_for_text_shader);
+	glBindVertexArray(vertex_buffer_for_text_shader);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+	//Position and TexCoord are adjacent, so they are read together as one vec4 ("vertex" in text.vs):
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(DrawUI::Vertex), (GLbyte *)0 + offsetof(DrawUI::Vertex, Position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawUI::Vertex), (GLbyte *)0 + offsetof(DrawUI::Vertex, Color));
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
+});
+
+DrawUI::DrawUI(GlyphAtlas const &atlas_, glm::vec2 const &canvas_size) : atlas(atlas_) {
+	canvas_to_clip = glm::ortho(0.0f, canvas_size.x, 0.0f, canvas_size.y);
+}
+
+void DrawUI::quad(GLuint texture, glm::vec2 const &min, glm::vec2 const &max, glm::vec2 const &tex_min, glm::vec2 const &tex_max, glm::u8vec4 const &color) {
+	if (runs.empty() || runs.back().layer != layer || runs.back().texture != texture) {
+		runs.emplace_back();
+		runs.back().layer = layer;
+		runs.back().texture = texture;
+		runs.back().begin = runs.back().end = uint32_t(vertices.size());
+	}
+
+	vertices.emplace_back(glm::vec2(min.x, min.y), glm::vec2(tex_min.x, tex_min.y), color);
+	vertices.emplace_back(glm::vec2(max.x, min.y), glm::vec2(tex_max.x, tex_min.y), color);
+	vertices.emplace_back(glm::vec2(max.x, max.y), glm::vec2(tex_max.x, tex_max.y), color);
+
+	vertices.emplace_back(glm::vec2(min.x, min.y), glm::vec2(tex_min.x, tex_min.y), color);
+	vertices.emplace_back(glm::vec2(max.x, max.y), glm::vec2(tex_max.x, tex_max.y), color);
+	vertices.emplace_back(glm::vec2(min.x, max.y), glm::vec2(tex_min.x, tex_max.y), color);
+
+	runs.back().end = uint32_t(vertices.size());
+}
+
+glm::vec2 DrawUI::text(std::string const &str, glm::vec2 const &anchor, float scale, glm::u8vec4 const &color) {
+	return text(TextLayout::get(atlas, str, scale), anchor, color);
+}
+
+glm::vec2 DrawUI::text(TextLayout const &layout, glm::vec2 const &anchor, glm::u8vec4 const &color) {
+	for (TextLayout::Quad const &q : layout.quads) {
+		quad(atlas.texture, anchor + q.min, anchor + q.max, q.tex_min, q.tex_max, color);
+	}
+	return anchor + layout.end;
+}
+
+void DrawUI::rect(glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color) {
+	quad(atlas.texture, min, max, atlas.solid_tex, atlas.solid_tex, color);
+}
+
+DrawUI::~DrawUI() {
+	if (vertices.empty()) return;
+	PROFILE_SCOPE("DrawUI::flush");
+
+	//put runs in (layer, texture) order; stable so quads keep their drawing order within a group:
+	std::stable_sort(runs.begin(), runs.end(), [](Run const &a, Run const &b) {
+		if (a.layer != b.layer) return a.layer < b.layer;
+		return a.texture < b.texture;
+	});
+
+	//gather vertices in sorted order, merging neighboring runs that use the same texture:
+	std::vector< Vertex > sorted;
+	sorted.reserve(vertices.size());
+	std::vector< Run > batches;
+	for (Run const &run : runs) {
+		if (batches.empty() || batches.back().texture != run.texture) {
+			batches.emplace_back(run);
+			batches.back().begin = uint32_t(sorted.size());
+		}
+		sorted.insert(sorted.end(), vertices.begin() + run.begin, vertices.begin() + run.end);
+		batches.back().end = uint32_t(sorted.size());
+	}
+
+	//upload vertices:
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sorted.size() * sizeof(Vertex), sorted.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//UI is drawn over everything, blended:
+	GLboolean was_depth_testing = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean was_blending = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	//program + uniforms + vertex array are bound once for the whole batch:
+	glUseProgram(text_shader->ID);
+	glUniformMatrix4fv(text_shader_projection, 1, GL_FALSE, glm::value_ptr(canvas_to_clip));
+	gl_stats.uniform_uploads += 1;
+	glBindVertexArray(vertex_buffer_for_text_shader);
+	glActiveTexture(GL_TEXTURE0);
+	gl_stats.state_changes += 2;
+
+	//...and then one draw call per texture change:
+	for (Run const &batch : batches) {
+		glBindTexture(GL_TEXTURE_2D, batch.texture);
+		glDrawArrays(GL_TRIANGLES, batch.begin, batch.end - batch.begin);
+		gl_stats.draw_calls += 1;
+		gl_stats.vertices += batch.end - batch.begin;
+		gl_stats.state_changes += 1;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	if (was_depth_testing) glEnable(GL_DEPTH_TEST);
+	if (!was_blending) glDisable(GL_BLEND);
+
+	GL_ERRORS();
+}
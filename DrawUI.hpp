@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ * Helper class for immediate-mode drawing of screen-space UI (text and solid rectangles).
+ *
+ * Usage is like DrawLines: make a DrawUI at the start of the HUD pass, call text() / rect(),
+ * and everything is drawn when it goes out of scope. Quads are collected into one vertex
+ * array, sorted by (layer, texture), and drawn with one draw call per run of matching
+ * texture -- so text and rectangles drawn from the same GlyphAtlas cost a single draw call.
+ *
+ * Drawing order is preserved within a layer for quads that share a texture;
+ * use 'layer' to force things (e.g., panels) underneath other things.
+ *
+ */
+
+#include "GlyphAtlas.hpp"
+#include "TextLayout.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+struct DrawUI {
+	//Start drawing; coordinates are in pixels, with (0,0) at the lower left of a canvas_size canvas.
+	// 'atlas' is used for text() and provides the solid texel used by rect():
+	DrawUI(GlyphAtlas const &atlas, glm::vec2 const &canvas_size);
+
+	//draw a string with its baseline starting at 'anchor', scaled by 'scale' relative to atlas.pixel_size:
+	// returns the pen position after the last character.
+	// (layout is fetched from the TextLayout cache)
+	glm::vec2 text(std::string const &str, glm::vec2 const &anchor, float scale, glm::u8vec4 const &color = glm::u8vec4(0xff));
+
+	//draw an already laid-out string with its first baseline starting at 'anchor':
+	// (layout must have been made with this DrawUI's atlas)
+	glm::vec2 text(TextLayout const &layout, glm::vec2 const &anchor, glm::u8vec4 const &color = glm::u8vec4(0xff));
+
+	//draw a solid rectangle:
+	void rect(glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color);
+
+	//layer for subsequently drawn quads; lower layers are drawn first:
+	uint32_t layer = 0;
+
+	//Finish drawing (push quads to GPU):
+	~DrawUI();
+
+	//-- internals --
+
+	GlyphAtlas const &atlas;
+	glm::mat4 canvas_to_clip;
+
+	struct Vertex {
+		Vertex(glm::vec2 const &Position_, glm::vec2 const &TexCoord_, glm::u8vec4 const &Color_) : Position(Position_), TexCoord(TexCoord_), Color(Color_) { }
+		glm::vec2 Position;
+		glm::vec2 TexCoord;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 2*4 + 2*4 + 4*1, "Vertex is packed.");
+	std::vector< Vertex > vertices;
+
+	//consecutive quads with the same layer and texture are grouped into runs:
+	struct Run {
+		uint32_t layer = 0;
+		GLuint texture = 0;
+		uint32_t begin = 0; //first vertex
+		uint32_t end = 0; //one past last vertex
+	};
+	std::vector< Run > runs;
+
+	void quad(GLuint texture, glm::vec2 const &min, glm::vec2 const &max, glm::vec2 const &tex_min, glm::vec2 const &tex_max, glm::u8vec4 const &color);
+};
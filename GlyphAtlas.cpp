@@ -0,0 +1,127 @@
+#include "GlyphAtlas.hpp"
+
+#include "gl_errors.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+
+GlyphAtlas::GlyphAtlas(std::string const &font_file, uint32_t pixel_size_) : pixel_size(pixel_size_) {
+	FT_Library ft = nullptr;
+	if (FT_Init_FreeType(&ft)) {
+		throw std::runtime_error("Error initializing FreeType library.");
+	}
+	FT_Face face = nullptr;
+	if (FT_New_Face(ft, font_file.c_str(), 0, &face)) {
+		FT_Done_FreeType(ft);
+		throw std::runtime_error("Error loading font face from '" + font_file + "'.");
+	}
+	FT_Set_Pixel_Sizes(face, 0, pixel_size);
+
+	ascender = face->size->metrics.ascender / 64.0f;
+	descender = face->size->metrics.descender / 64.0f;
+	line_height = face->size->metrics.height / 64.0f;
+
+	//glyphs are packed into rows ("shelves") of a fixed-width image, which grows downward as needed:
+	constexpr uint32_t Width = 512;
+	constexpr uint32_t Padding = 1; //blank texels between glyphs so linear filtering doesn't bleed
+	std::vector< uint8_t > pixels;
+	uint32_t height = 0;
+	auto ensure_height = [&](uint32_t h) {
+		if (h > height) {
+			height = h;
+			pixels.resize(Width * height, 0);
+		}
+	};
+
+	glm::uvec2 pen = glm::uvec2(Padding, Padding);
+	uint32_t shelf_height = 0;
+
+	//start with a small fully-covered block for solid rectangles:
+	{
+		ensure_height(pen.y + 4);
+		for (uint32_t y = 0; y < 4; ++y) {
+			for (uint32_t x = 0; x < 4; ++x) {
+				pixels[(pen.y + y) * Width + (pen.x + x)] = 0xff;
+			}
+		}
+		solid_tex = glm::vec2(pen.x + 2, pen.y + 2); //(converted to texture coordinates below)
+		pen.x += 4 + Padding;
+		shelf_height = 4;
+	}
+
+	//store printable ASCII glyphs:
+	for (uint32_t c = 32; c < 127; ++c) {
+		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+			std::cerr << "WARNING: error loading glyph for '" << char(c) << "' from '" << font_file << "'." << std::endl;
+			continue;
+		}
+		FT_Bitmap const &bitmap = face->glyph->bitmap;
+
+		if (pen.x + bitmap.width + Padding > Width) {
+			//start a new shelf:
+			pen.x = Padding;
+			pen.y += shelf_height + Padding;
+			shelf_height = 0;
+		}
+		if (bitmap.width + 2 * Padding > Width) {
+			throw std::runtime_error("Glyph for '" + std::string(1, char(c)) + "' is too wide for atlas.");
+		}
+		ensure_height(pen.y + bitmap.rows + Padding);
+
+		for (uint32_t y = 0; y < bitmap.rows; ++y) {
+			for (uint32_t x = 0; x < bitmap.width; ++x) {
+				pixels[(pen.y + y) * Width + (pen.x + x)] = bitmap.buffer[y * bitmap.pitch + x];
+			}
+		}
+
+		Glyph &g = glyphs[c];
+		g.present = true;
+		g.size = glm::vec2(bitmap.width, bitmap.rows);
+		g.bearing = glm::vec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+		g.advance = face->glyph->advance.x / 64.0f;
+		g.tex_min = glm::vec2(pen.x, pen.y); //(converted to texture coordinates below)
+		g.tex_max = glm::vec2(pen.x + bitmap.width, pen.y + bitmap.rows);
+
+		pen.x += bitmap.width + Padding;
+		shelf_height = std::max(shelf_height, uint32_t(bitmap.rows));
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(ft);
+
+	texture_size = glm::uvec2(Width, height);
+
+	//convert pixel positions to texture coordinates:
+	// (image row 0 is uploaded as texture row 0, so glyph bitmaps end up "upside down" in texture space;
+	//  that's why tex_min is the *upper*-left corner of the glyph.)
+	glm::vec2 to_tex = 1.0f / glm::vec2(texture_size);
+	solid_tex *= to_tex;
+	for (auto &g : glyphs) {
+		g.tex_min *= to_tex;
+		g.tex_max *= to_tex;
+	}
+
+	//upload:
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, texture_size.x, texture_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GL_ERRORS();
+}
+
+GlyphAtlas::~GlyphAtlas() {
+	glDeleteTextures(1, &texture);
+	texture = 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+ * A GlyphAtlas rasterizes the printable ASCII glyphs of a font (using FreeType)
+ * into a single texture, so runs of text can be drawn from one texture bind.
+ *
+ * The texture is single-channel (GL_R8) coverage; it also contains a small
+ * fully-covered block so that solid rectangles can be drawn from the same texture.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <string>
+
+struct GlyphAtlas {
+	//rasterize glyphs from 'font_file' at 'pixel_size' pixels per em:
+	// note: will throw if font fails to load.
+	GlyphAtlas(std::string const &font_file, uint32_t pixel_size);
+	~GlyphAtlas();
+
+	//no copying (owns a texture):
+	GlyphAtlas(GlyphAtlas const &) = delete;
+	GlyphAtlas &operator=(GlyphAtlas const &) = delete;
+
+	struct Glyph {
+		bool present = false; //did this character have a glyph in the font?
+		glm::vec2 size = glm::vec2(0.0f); //bitmap size, in pixels
+		glm::vec2 bearing = glm::vec2(0.0f); //offset from pen position to upper-left of bitmap, in pixels (+y is up)
+		float advance = 0.0f; //pen advance, in pixels
+		glm::vec2 tex_min = glm::vec2(0.0f); //texture coordinate of upper-left of bitmap
+		glm::vec2 tex_max = glm::vec2(0.0f); //texture coordinate of lower-right of bitmap
+	};
+	//glyphs indexed by (ASCII) character:
+	std::array< Glyph, 128 > glyphs;
+
+	Glyph const &glyph(char c) const {
+		return glyphs[uint8_t(c) & 0x7f];
+	}
+
+	//texture coordinate of a fully-covered texel (for drawing solid rectangles):
+	glm::vec2 solid_tex = glm::vec2(0.0f);
+
+	//font metrics, in pixels:
+	uint32_t pixel_size = 0;
+	float ascender = 0.0f; //baseline to top of tallest glyph
+	float descender = 0.0f; //baseline to bottom of lowest glyph (negative)
+	float line_height = 0.0f; //baseline to baseline
+
+	//texture holding all the glyphs:
+	GLuint texture = 0;
+	glm::uvec2 texture_size = glm::uvec2(0);
+};
@@ -0,0 +1,192 @@
+#include "HeadlessGL.hpp"
+
+#include "gl_errors.hpp"
+#include "gl_stats.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+HeadlessGL::HeadlessGL(glm::uvec2 const &size_) : size(size_) {
+	//prefer Mesa's surfaceless platform (needs no X or Wayland server at all), falling back to the default display:
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display) {
+		egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major = 0, minor = 0;
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+		throw std::runtime_error("Failed to initialize an EGL display for headless rendering.");
+	}
+	display = egl_display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		throw std::runtime_error("EGL display does not support desktop OpenGL.");
+	}
+
+	EGLint const config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+		throw std::runtime_error("No suitable EGL config for headless rendering.");
+	}
+
+	//same version and profile as the windowed programs ask for:
+	EGLint const context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	if (egl_context == EGL_NO_CONTEXT) {
+		throw std::runtime_error("Failed to create an OpenGL 3.3 core context with EGL.");
+	}
+	context = egl_context;
+
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+		//no EGL_KHR_surfaceless_context; make current with a tiny pbuffer instead (we still draw to our own framebuffer):
+		EGLint const pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		EGLSurface egl_surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attribs);
+		if (egl_surface == EGL_NO_SURFACE || !eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+			throw std::runtime_error("Failed to make headless EGL context current.");
+		}
+		surface = egl_surface;
+	}
+
+	std::cout << "Headless rendering with EGL " << major << "." << minor << " on '" << (char const *)glGetString(GL_RENDERER) << "'." << std::endl;
+
+	//offscreen framebuffer:
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+	glGenRenderbuffers(1, &depth_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Headless framebuffer is incomplete.");
+	}
+
+	glViewport(0, 0, size.x, size.y);
+
+	GL_ERRORS();
+}
+
+HeadlessGL::~HeadlessGL() {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color_renderbuffer);
+	glDeleteRenderbuffers(1, &depth_renderbuffer);
+
+	EGLDisplay egl_display = EGLDisplay(display);
+	eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface) eglDestroySurface(egl_display, EGLSurface(surface));
+	eglDestroyContext(egl_display, EGLContext(context));
+	eglTerminate(egl_display);
+}
+
+#else //not linux
+
+HeadlessGL::HeadlessGL(glm::uvec2 const &size_) : size(size_) {
+	throw std::runtime_error("Headless rendering is only supported on Linux (EGL).");
+}
+
+HeadlessGL::~HeadlessGL() {
+}
+
+#endif
+
+void benchmark_frames(uint32_t warmup_count, uint32_t frame_count, std::function< void() > const &draw_frame, uint32_t pixel_count) {
+	bool const old_count_samples = gl_stats_count_samples;
+	gl_stats_count_samples = (pixel_count != 0);
+
+	for (uint32_t i = 0; i < warmup_count; ++i) {
+		draw_frame();
+		glFinish();
+		gl_stats_next_frame();
+		Profiler::end_frame();
+	}
+
+	std::vector< float > frame_ms;
+	frame_ms.reserve(frame_count);
+	uint64_t draw_calls = 0, vertices = 0, uniform_uploads = 0, state_changes = 0, samples_passed = 0;
+
+	for (uint32_t i = 0; i < frame_count; ++i) {
+		auto before = std::chrono::high_resolution_clock::now();
+		draw_frame();
+		glFinish(); //(include GPU time -- there is no swap to wait on)
+		auto after = std::chrono::high_resolution_clock::now();
+		frame_ms.emplace_back(std::chrono::duration< float, std::milli >(after - before).count());
+
+		draw_calls += gl_stats.draw_calls;
+		vertices += gl_stats.vertices;
+		uniform_uploads += gl_stats.uniform_uploads;
+		state_changes += gl_stats.state_changes;
+		samples_passed += gl_stats.samples_passed;
+		gl_stats_next_frame();
+		Profiler::end_frame();
+	}
+	GL_ERRORS();
+
+	gl_stats_count_samples = old_count_samples;
+
+	if (frame_ms.empty()) return;
+
+	float total = 0.0f;
+	for (float ms : frame_ms) total += ms;
+	std::sort(frame_ms.begin(), frame_ms.end());
+	auto percentile = [&](float p) {
+		size_t index = std::min(frame_ms.size() - 1, size_t(p / 100.0f * frame_ms.size()));
+		return frame_ms[index];
+	};
+
+	std::cout << "Benchmark: " << frame_count << " frames (after " << warmup_count << " warmup)\n";
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  frame ms: mean " << total / frame_ms.size()
+	          << "  min " << frame_ms.front()
+	          << "  p50 " << percentile(50.0f)
+	          << "  p90 " << percentile(90.0f)
+	          << "  p99 " << percentile(99.0f)
+	          << "  max " << frame_ms.back() << "\n";
+	std::cout << std::setprecision(1);
+	std::cout << "  per frame: " << float(draw_calls) / frame_count << " draw calls, "
+	          << float(vertices) / frame_count << " vertices, "
+	          << float(uniform_uploads) / frame_count << " uniform uploads, "
+	          << float(state_changes) / frame_count << " state changes" << std::endl;
+	if (pixel_count) {
+		std::cout << std::setprecision(3);
+		std::cout << "  overdraw: " << double(samples_passed) / frame_count / pixel_count << " samples shaded per pixel" << std::endl;
+	}
+}
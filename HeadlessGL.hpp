@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * HeadlessGL creates an OpenGL 3.3 core context without a window
+ * (EGL; on machines without a GPU, Mesa's llvmpipe works fine),
+ * and binds an offscreen framebuffer of the requested size to draw into.
+ *
+ * Used by the '--headless' benchmark mode of the game and show-scene.
+ *
+ * note: only available on Linux; the constructor throws elsewhere.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+
+struct HeadlessGL {
+	HeadlessGL(glm::uvec2 const &size);
+	~HeadlessGL();
+
+	HeadlessGL(HeadlessGL const &) = delete;
+	HeadlessGL &operator=(HeadlessGL const &) = delete;
+
+	glm::uvec2 size;
+
+	//EGL handles (opaque here so EGL headers don't leak into other files):
+	void *display = nullptr;
+	void *context = nullptr;
+	void *surface = nullptr; //only used if the driver can't make a surfaceless context current
+
+	//offscreen framebuffer (left bound as GL_FRAMEBUFFER):
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+};
+
+//Call 'draw_frame' 'frame_count' times (after 'warmup_count' untimed calls),
+// waiting for the GPU to finish each frame, then print frame time percentiles
+// and per-frame draw call / uniform / state change counts (from gl_stats) to std::cout.
+// With 'pixel_count' set, also count samples in GLSamplesScopes and report overdraw (samples per pixel):
+void benchmark_frames(uint32_t warmup_count, uint32_t frame_count, std::function< void() > const &draw_frame, uint32_t pixel_count = 0);
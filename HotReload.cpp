@@ -0,0 +1,214 @@
+#include "HotReload.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+namespace {
+	struct Watch {
+		std::vector< std::string > files;
+		HotReload::Reload reload;
+	};
+
+	std::mutex mutex; //guards everything below
+	std::vector< Watch > watches;
+	std::vector< std::pair< uint32_t, HotReload::Commit > > ready; //(index in watches, commit), waiting for commit()
+
+	std::thread watcher;
+	std::atomic< bool > stopping(false);
+
+	//editors often save with several writes (or write + rename), so wait for changes to settle before reloading:
+	constexpr auto SettleTime = std::chrono::milliseconds(100);
+
+	//run the first stage of every reload affected by 'changed', then queue their commits together:
+	void reload_changed(std::set< std::string > const &changed) {
+		std::vector< Watch > current;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			current = watches;
+		}
+
+		std::vector< std::pair< uint32_t, HotReload::Commit > > batch;
+		for (uint32_t i = 0; i < current.size(); ++i) {
+			Watch const &watch = current[i];
+			if (std::none_of(watch.files.begin(), watch.files.end(), [&](std::string const &f){ return changed.count(f); })) continue;
+
+			PROFILE_SCOPE("hot reload");
+			try {
+				HotReload::Commit commit = watch.reload();
+				if (commit) batch.emplace_back(i, commit);
+			} catch (std::exception &e) {
+				std::cerr << "Failed to reload '" << watch.files[0] << "' (keeping old version): " << e.what() << std::endl;
+			}
+		}
+
+		std::unique_lock< std::mutex > lock(mutex);
+		ready.insert(ready.end(), batch.begin(), batch.end());
+	}
+
+	#if defined(__linux__)
+	std::string directory_of(std::string const &path) {
+		size_t slash = path.find_last_of("/\\");
+		if (slash == std::string::npos) return ".";
+		return path.substr(0, slash);
+	}
+
+	void watch_thread() {
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0) {
+			std::cerr << "Failed to start inotify; hot reloading is disabled." << std::endl;
+			return;
+		}
+
+		//watch each directory that contains a watched file (so saves that replace the file by renaming are seen):
+		std::map< int, std::string > directories;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			std::set< std::string > dirs;
+			for (auto const &watch : watches) {
+				for (auto const &file : watch.files) dirs.insert(directory_of(file));
+			}
+			for (auto const &dir : dirs) {
+				int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (wd < 0) std::cerr << "Failed to watch directory '" << dir << "'." << std::endl;
+				else directories[wd] = dir;
+			}
+		}
+
+		std::set< std::string > changed;
+		auto last_change = std::chrono::steady_clock::now();
+		alignas(struct inotify_event) char buffer[4096];
+		while (!stopping) {
+			pollfd pfd{fd, POLLIN, 0};
+			if (poll(&pfd, 1, 50) > 0) {
+				ssize_t len;
+				while ((len = read(fd, buffer, sizeof(buffer))) > 0) {
+					for (char const *at = buffer; at < buffer + len; ) {
+						auto const *event = reinterpret_cast< struct inotify_event const * >(at);
+						auto f = directories.find(event->wd);
+						if (f != directories.end() && event->len) {
+							changed.insert(f->second + "/" + event->name);
+							last_change = std::chrono::steady_clock::now();
+						}
+						at += sizeof(struct inotify_event) + event->len;
+					}
+				}
+			}
+			if (!changed.empty() && std::chrono::steady_clock::now() - last_change >= SettleTime) {
+				reload_changed(changed);
+				changed.clear();
+			}
+		}
+
+		close(fd);
+	}
+	#else
+	//no inotify; poll modification times instead:
+	void watch_thread() {
+		namespace fs = std::filesystem;
+		std::map< std::string, fs::file_time_type > times;
+		auto scan = [&times](std::set< std::string > *changed) {
+			std::vector< std::string > files;
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				for (auto const &watch : watches) files.insert(files.end(), watch.files.begin(), watch.files.end());
+			}
+			for (auto const &file : files) {
+				std::error_code ec;
+				fs::file_time_type time = fs::last_write_time(file, ec);
+				if (ec) continue;
+				auto f = times.find(file);
+				if (f == times.end()) {
+					times.emplace(file, time);
+				} else if (f->second != time) {
+					f->second = time;
+					if (changed) changed->insert(file);
+				}
+			}
+		};
+		scan(nullptr);
+
+		std::set< std::string > changed;
+		while (!stopping) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			scan(&changed);
+			if (!changed.empty()) {
+				//(the poll interval is longer than SettleTime, so a burst of saves has mostly settled)
+				reload_changed(changed);
+				changed.clear();
+			}
+		}
+	}
+	#endif
+}
+
+void HotReload::watch(std::vector< std::string > const &files, Reload const &reload) {
+	if (!enabled) return;
+	if (files.empty()) throw std::runtime_error("HotReload::watch needs at least one file.");
+	std::unique_lock< std::mutex > lock(mutex);
+	watches.emplace_back(Watch{files, reload});
+}
+
+void HotReload::start() {
+	if (!enabled || watcher.joinable()) return;
+	stopping = false;
+	watcher = std::thread(watch_thread);
+	std::cout << "Hot reloading " << watches.size() << " resources." << std::endl;
+}
+
+uint32_t HotReload::commit() {
+	std::vector< std::pair< uint32_t, Commit > > batch;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		if (ready.empty()) return 0;
+		batch.swap(ready);
+	}
+
+	PROFILE_SCOPE("hot reload commit");
+
+	//commit in registration order, so resources are swapped after the resources they depend on:
+	std::stable_sort(batch.begin(), batch.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+
+	uint32_t committed = 0;
+	for (auto &entry : batch) {
+		try {
+			entry.second();
+			committed += 1;
+		} catch (std::exception &e) {
+			std::cerr << "Failed to commit reload (keeping old version): " << e.what() << std::endl;
+		}
+	}
+	std::cout << "Hot reloaded " << committed << " resources." << std::endl;
+	return committed;
+}
+
+void HotReload::stop() {
+	if (!watcher.joinable()) return;
+	stopping = true;
+	watcher.join();
+}
+
+std::string HotReload::read_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "'.");
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
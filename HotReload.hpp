@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * Hot reloading: watches the files resources were loaded from and reloads
+ * just those resources when the files change, without restarting.
+ *
+ * A resource registers the files it depends on and a two-stage reload function:
+ *
+ *   Load< Thing > thing(LoadTagDefault, []() -> Thing const * {
+ *       Thing *ret = new Thing(data_path("thing.dat"));
+ *       HotReload::watch({data_path("thing.dat")}, [ret]() -> HotReload::Commit {
+ *           auto contents = std::make_shared< Thing::Contents >(Thing::read(data_path("thing.dat"))); //background thread
+ *           return [ret, contents](){ ret->upload(std::move(*contents)); }; //main thread, between frames
+ *       });
+ *       return ret;
+ *   });
+ *
+ *  - The first stage runs on the watcher thread; it should do the slow part (reading, parsing, decoding) and no GL.
+ *  - The returned Commit runs in HotReload::commit(), which the main loop calls between frames.
+ *    All reloads triggered by one burst of changes are committed together, in the order they were registered,
+ *    so a resource can depend on another being committed first.
+ *  - Commits update the resource in place, so pointers to it (and GL names inside it) stay valid.
+ *  - If either stage throws, the error is printed and the old version stays.
+ *
+ * On Linux files are watched with inotify; elsewhere, modification times are polled.
+ *
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace HotReload {
+	//master switch; set before call_load_functions() (watch() does nothing when false):
+	inline bool enabled = false;
+
+	typedef std::function< void() > Commit;
+	typedef std::function< Commit() > Reload;
+
+	//call 'reload' when any of 'files' change:
+	void watch(std::vector< std::string > const &files, Reload const &reload);
+
+	//start the watcher thread (after call_load_functions()):
+	void start();
+
+	//run finished reloads on the calling (main) thread; returns the number committed:
+	uint32_t commit();
+
+	//stop the watcher thread:
+	void stop();
+
+	//read a whole file (e.g., shader source) into a string; throws if it can't be read:
+	std::string read_file(std::string const &filename);
+}
@@ -0,0 +1,266 @@
+#include "Jobs.hpp"
+
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+	struct Worker {
+		std::mutex mutex;
+		std::deque< Jobs::Job > jobs; //the worker's own end is the back; thieves take from the front
+	};
+
+	struct Pool {
+		//n.b. workers and threads only change in start()/stop(), when no jobs are running:
+		std::vector< std::unique_ptr< Worker > > workers;
+		std::vector< std::thread > threads;
+
+		std::mutex shared_mutex;
+		std::deque< Jobs::Job > shared_jobs; //jobs from threads that aren't workers
+
+		//jobs in any queue (counted just before they're pushed, so idle workers can tell when to look):
+		std::atomic< int32_t > queued{0};
+
+		//idle workers sleep here:
+		std::mutex sleep_mutex;
+		std::condition_variable wake;
+		std::atomic< uint32_t > sleeping{0};
+		std::atomic< bool > stopping{false};
+
+		std::mutex start_mutex;
+		std::atomic< bool > started{false};
+
+		~Pool();
+	};
+
+	Pool &get_pool() {
+		static Pool pool;
+		return pool;
+	}
+
+	//index of the calling thread in Pool::workers (or -1U for threads that aren't workers):
+	thread_local uint32_t worker_index = -1U;
+
+	void push(Pool &pool, Jobs::Job &&job) {
+		pool.queued.fetch_add(1);
+		if (worker_index != -1U) {
+			Worker &worker = *pool.workers[worker_index];
+			std::lock_guard< std::mutex > lock(worker.mutex);
+			worker.jobs.emplace_back(std::move(job));
+		} else {
+			std::lock_guard< std::mutex > lock(pool.shared_mutex);
+			pool.shared_jobs.emplace_back(std::move(job));
+		}
+		//(a worker counts itself as sleeping before it checks 'queued', so one of us sees the other's change)
+		if (pool.sleeping.load() > 0) {
+			std::lock_guard< std::mutex > lock(pool.sleep_mutex);
+			pool.wake.notify_one();
+		}
+	}
+
+	//take a job: from the back of our own deque, then the shared queue, then the front of another worker's deque:
+	bool take(Pool &pool, Jobs::Job *job) {
+		if (pool.queued.load(std::memory_order_relaxed) <= 0) return false;
+
+		auto pop = [&](std::mutex &mutex, std::deque< Jobs::Job > &jobs, bool back) {
+			std::lock_guard< std::mutex > lock(mutex);
+			if (jobs.empty()) return false;
+			if (back) {
+				*job = std::move(jobs.back());
+				jobs.pop_back();
+			} else {
+				*job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			return true;
+		};
+
+		uint32_t count = uint32_t(pool.workers.size());
+		bool found = false;
+		if (worker_index != -1U) {
+			found = pop(pool.workers[worker_index]->mutex, pool.workers[worker_index]->jobs, true);
+		}
+		if (!found) {
+			found = pop(pool.shared_mutex, pool.shared_jobs, false);
+		}
+		if (!found && count) {
+			//(start from the next worker over, so thieves spread out over their victims)
+			static thread_local uint32_t next_victim = 0;
+			uint32_t first = (worker_index != -1U ? worker_index + 1 : next_victim++);
+			for (uint32_t i = 0; i < count && !found; ++i) {
+				uint32_t victim = (first + i) % count;
+				if (victim == worker_index) continue;
+				found = pop(pool.workers[victim]->mutex, pool.workers[victim]->jobs, false);
+			}
+		}
+		if (found) pool.queued.fetch_sub(1);
+		return found;
+	}
+
+	void finish(Pool &pool, Jobs::Counter &counter) {
+		std::vector< Jobs::Job > ready;
+		{
+			std::lock_guard< std::mutex > lock(counter.mutex);
+			assert(counter.pending.load() > 0);
+			if (counter.pending.load() == 1) ready.swap(counter.continuations);
+			counter.pending.fetch_sub(1, std::memory_order_release);
+		}
+		for (auto &job : ready) push(pool, std::move(job));
+	}
+
+	void execute(Pool &pool, Jobs::Job &job) {
+		try {
+			job.fn();
+		} catch (...) {
+			if (job.counter) {
+				std::lock_guard< std::mutex > lock(job.counter->mutex);
+				if (!job.counter->exception) job.counter->exception = std::current_exception();
+			} else {
+				//nobody is waiting to hear about it:
+				try {
+					throw;
+				} catch (std::exception &e) {
+					std::cerr << "ERROR: job threw: " << e.what() << std::endl;
+				} catch (...) {
+					std::cerr << "ERROR: job threw." << std::endl;
+				}
+			}
+		}
+		if (job.counter) finish(pool, *job.counter);
+	}
+
+	void worker_main(uint32_t index) {
+		worker_index = index;
+		Pool &pool = get_pool();
+		Jobs::Job job;
+		while (true) {
+			if (take(pool, &job)) {
+				execute(pool, job);
+				job = Jobs::Job();
+				continue;
+			}
+			if (pool.stopping.load()) break;
+
+			//nothing to do; sleep until something is pushed:
+			std::unique_lock< std::mutex > lock(pool.sleep_mutex);
+			pool.sleeping.fetch_add(1);
+			pool.wake.wait(lock, [&pool](){ return pool.queued.load() > 0 || pool.stopping.load(); });
+			pool.sleeping.fetch_sub(1);
+		}
+		worker_index = -1U;
+	}
+
+	//(with start_mutex held)
+	void start_workers(Pool &pool, uint32_t count) {
+		assert(!pool.started && pool.workers.empty() && pool.threads.empty());
+		for (uint32_t i = 0; i < count; ++i) {
+			pool.workers.emplace_back(std::make_unique< Worker >());
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			pool.threads.emplace_back(worker_main, i);
+		}
+		pool.started = true;
+	}
+
+	void stop_workers(Pool &pool) {
+		{
+			std::lock_guard< std::mutex > lock(pool.start_mutex);
+			if (!pool.started) return;
+			{
+				std::lock_guard< std::mutex > sleep_lock(pool.sleep_mutex);
+				pool.stopping = true;
+			}
+			pool.wake.notify_all();
+			for (auto &thread : pool.threads) thread.join();
+			pool.threads.clear();
+		}
+
+		//run whatever is left (anything these jobs spawn goes to the shared queue):
+		Jobs::Job job;
+		while (take(pool, &job)) {
+			execute(pool, job);
+			job = Jobs::Job();
+		}
+
+		std::lock_guard< std::mutex > lock(pool.start_mutex);
+		pool.workers.clear();
+		pool.stopping = false;
+		pool.started = false;
+	}
+
+	Pool::~Pool() {
+		stop_workers(*this);
+	}
+
+	Pool &started_pool() {
+		Pool &pool = get_pool();
+		if (!pool.started.load(std::memory_order_acquire)) {
+			std::lock_guard< std::mutex > lock(pool.start_mutex);
+			if (!pool.started) {
+				//one worker per core, less the thread that is waiting for them:
+				uint32_t cores = std::thread::hardware_concurrency();
+				start_workers(pool, cores > 1 ? cores - 1 : 0);
+			}
+		}
+		return pool;
+	}
+}
+
+void Jobs::start(uint32_t workers) {
+	Pool &pool = get_pool();
+	stop_workers(pool);
+	std::lock_guard< std::mutex > lock(pool.start_mutex);
+	start_workers(pool, workers);
+}
+
+void Jobs::stop() {
+	stop_workers(get_pool());
+}
+
+uint32_t Jobs::worker_count() {
+	return uint32_t(started_pool().threads.size());
+}
+
+void Jobs::run(std::function< void() > const &job, Counter *counter) {
+	Pool &pool = started_pool();
+	if (counter) counter->pending.fetch_add(1);
+	push(pool, Job{job, counter});
+}
+
+void Jobs::then(Counter &after, std::function< void() > const &job, Counter *counter) {
+	Pool &pool = started_pool();
+	if (counter) counter->pending.fetch_add(1);
+	{
+		std::lock_guard< std::mutex > lock(after.mutex);
+		if (after.pending.load() != 0) {
+			after.continuations.emplace_back(Job{job, counter});
+			return;
+		}
+	}
+	push(pool, Job{job, counter});
+}
+
+void Jobs::wait(Counter &counter) {
+	Pool &pool = get_pool();
+	Job job;
+	while (!counter.done()) {
+		if (take(pool, &job)) {
+			execute(pool, job);
+			job = Job();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	//taking the lock also waits for the thread that finished the last job to let go of the counter:
+	std::exception_ptr exception;
+	{
+		std::lock_guard< std::mutex > lock(counter.mutex);
+		std::swap(exception, counter.exception);
+	}
+	if (exception) std::rethrow_exception(exception);
+}
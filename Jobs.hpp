@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+ * Jobs is a work-stealing job system: a pool of worker threads that run
+ * small functions ("jobs") for loading, decoding, and per-frame preparation.
+ *
+ *   Jobs::Counter done;
+ *   for (auto &thing : things) {
+ *       Jobs::run([&thing](){ thing.process(); }, &done);
+ *   }
+ *   Jobs::wait(done); //(runs jobs itself until every job counted by 'done' has finished)
+ *
+ *  - Each worker has its own deque. Jobs a worker spawns go on the back of its deque, and it takes
+ *    from the back (newest first, while their data is still in cache); idle workers steal from the front
+ *    of other workers' deques (oldest first -- usually the biggest pieces of work left).
+ *    Jobs spawned by other threads (e.g., the main thread) go to a shared queue.
+ *  - Dependencies are continuations: then(counter, job) runs 'job' once everything counted by 'counter'
+ *    has finished, without any thread blocking in the meantime.
+ *  - wait() doesn't just block: the waiting thread runs queued jobs until its counter reaches zero,
+ *    so waiting from inside a job (or with no workers at all) can't deadlock.
+ *  - If a job throws, the first exception is kept in its counter and rethrown by wait().
+ *
+ * Jobs must not use OpenGL (the context belongs to the main thread).
+ *
+ * The pool starts on first use with one worker per core beyond the caller's;
+ * call start() beforehand to choose the number (0 runs every job on whoever waits).
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Jobs {
+	struct Counter;
+
+	struct Job {
+		std::function< void() > fn;
+		Counter *counter = nullptr; //decremented once fn returns (may be null)
+	};
+
+	//Counts unfinished jobs (and holds what should happen once they're done):
+	struct Counter {
+		Counter() = default;
+		Counter(Counter const &) = delete;
+		Counter &operator=(Counter const &) = delete;
+
+		bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+		std::atomic< uint32_t > pending{0};
+
+		std::mutex mutex; //guards the following, and the step of 'pending' to zero:
+		std::vector< Job > continuations; //scheduled when pending reaches zero
+		std::exception_ptr exception; //first exception thrown by a counted job
+	};
+
+	//start 'workers' worker threads (stopping any already running):
+	void start(uint32_t workers);
+
+	//finish any queued jobs on the calling thread, then stop the workers:
+	// (called automatically at exit)
+	void stop();
+
+	//number of worker threads (starting the pool if it hasn't been):
+	uint32_t worker_count();
+
+	//queue 'job' to run on some worker; if 'counter' is given, it counts the job until it finishes:
+	void run(std::function< void() > const &job, Counter *counter = nullptr);
+
+	//run 'job' once all the jobs counted by 'after' have finished (right away if they already have);
+	// 'counter', if given, counts the job from now until it finishes:
+	void then(Counter &after, std::function< void() > const &job, Counter *counter = nullptr);
+
+	//run jobs until all the jobs counted by 'counter' have finished; rethrows the first exception any of them threw:
+	void wait(Counter &counter);
+
+	//run body(begin, end) over chunks of [0, count), each with at least 'min_chunk' items, and return once all are done:
+	// (a few chunks per thread, so threads that finish early can steal the remainder of slow ones;
+	//  the calling thread runs the first chunk itself)
+	template< typename Body >
+	void parallel_for(uint32_t count, uint32_t min_chunk, Body const &body) {
+		if (count == 0) return;
+		min_chunk = std::max(1U, min_chunk);
+		uint32_t chunks = std::min(4U * (worker_count() + 1U), (count + min_chunk - 1U) / min_chunk);
+		if (chunks <= 1) {
+			body(0U, count);
+			return;
+		}
+
+		Counter done;
+		for (uint32_t c = 1; c < chunks; ++c) {
+			uint32_t begin = uint32_t(uint64_t(count) * c / chunks);
+			uint32_t end = uint32_t(uint64_t(count) * (c + 1) / chunks);
+			run([&body, begin, end](){ body(begin, end); }, &done);
+		}
+		//(the other chunks refer to 'body', so they must finish even if this one throws)
+		std::exception_ptr exception;
+		try {
+			body(0U, uint32_t(uint64_t(count) / chunks));
+		} catch (...) {
+			exception = std::current_exception();
+		}
+		wait(done);
+		if (exception) std::rethrow_exception(exception);
+	}
+}
@@ -9,6 +9,9 @@ struct LitColorTextureProgram {
 	LitColorTextureProgram();
 	~LitColorTextureProgram();
 
+	//(re)bind uniform blocks and set uniform defaults -- after construction or relinking:
+	void find_uniforms();
+
 	GLuint program = 0;
 
 	//Attribute (per-vertex variable) locations:
@@ -17,20 +20,14 @@ struct LitColorTextureProgram {
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
 
-	//Uniform (per-invocation variable) locations:
-	GLuint OBJECT_TO_CLIP_mat4 = -1U;
-	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
-	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
-
-	//lighting:
-	GLuint LIGHT_TYPE_int = -1U;
-	GLuint LIGHT_LOCATION_vec3 = -1U;
-	GLuint LIGHT_DIRECTION_vec3 = -1U;
-	GLuint LIGHT_ENERGY_vec3 = -1U;
-	GLuint LIGHT_CUTOFF_float = -1U;
-	
+	//Uniforms:
+	//"Object" block - object matrices (written by Scene::draw)
+	//"Frame" block - camera and light (set light via frame_block, see UniformBlocks.hpp)
+
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
+	//TEXTURE4..6 - clustered light lists (bound by ClusteredLights::update)
+	//TEXTURE7 - shadow map array (bound by ShadowMaps::update)
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
@@ -1,4 +1,6 @@
 #include "Load.hpp"
+#include "Jobs.hpp"
+#include "Profiler.hpp"
 
 #include <array>
 #include <list>
@@ -22,11 +24,40 @@ void call_load_functions() {
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
 
+	PROFILE_SCOPE("call_load_functions");
+
 	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+
+	//LoadTagJob functions run on the job system while the main thread does LoadTagEarly:
+	Jobs::Counter jobs_done;
+	for (auto const &fn : load_lists[LoadTagJob]) {
+		Jobs::run([fn](){
+			PROFILE_SCOPE("load job");
+			fn();
+		}, &jobs_done);
+	}
+	load_lists[LoadTagJob].clear();
+
+	try {
+		for (uint32_t tag = LoadTagEarly; tag < MaxLoadTag; ++tag) {
+			if (tag == LoadTagDefault) {
+				PROFILE_SCOPE("wait for load jobs");
+				Jobs::wait(jobs_done); //(rethrows the first exception a load job threw)
+			}
+			auto &fn_list = load_lists[tag];
+			while (!fn_list.empty()) {
+				PROFILE_SCOPE("load function");
+				(*fn_list.begin())(); //call first function in the list
+				fn_list.pop_front(); //remove from list
+			}
+		}
+	} catch (...) {
+		//load jobs refer to jobs_done, so let them finish before passing the error along:
+		try {
+			Jobs::wait(jobs_done);
+		} catch (...) {
+			//(already reporting an error)
 		}
+		throw;
 	}
 }
@@ -20,12 +20,16 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loads that only read and decode files (e.g. Sound::Sample) can use LoadTagJob to run on worker threads
+ * while the main thread gets on with the OpenGL ones.
+ *
  */
 
 #include <functional>
 #include <stdexcept>
 
 enum LoadTag : uint32_t {
+	LoadTagJob, //run in parallel on the job system (Jobs.hpp) alongside LoadTagEarly, all finished before LoadTagDefault; must not use OpenGL or other Load<>s
 	LoadTagEarly,
 	LoadTagDefault,
 	LoadTagLate,
@@ -69,6 +69,7 @@ if (maek.OS === "windows") {
 	maek.options.LINKLibs.push(
 		//linker flags for nest libraries:
 		`-L${NEST_LIBS}/SDL2/lib`, `-lSDL2`, `-lm`, `-ldl`, `-lasound`, `-lpthread`, `-lX11`, `-lXext`, `-lpthread`, `-lrt`, `-lGL`, //the output of sdl-config --static-libs
+		`-lEGL`, //for headless rendering (HeadlessGL)
 		`-L${NEST_LIBS}/libpng/lib`, `-lpng`,
 		`-L${NEST_LIBS}/zlib/lib`, `-lz`,
 		`-L${NEST_LIBS}/opusfile/lib`, `-lopusfile`,
@@ -138,25 +139,45 @@ if (maek.OS === 'windows') {
 const game_names = [
 	maek.CPP('PlayMode.cpp'),
 	maek.CPP('main.cpp'),
+	maek.CPP('GlyphAtlas.cpp'),
+	maek.CPP('TextLayout.cpp'),
+	maek.CPP('DrawUI.cpp'),
 	maek.CPP('LitColorTextureProgram.cpp'),
+	maek.CPP('ClusteredLights.cpp'),
+	maek.CPP('ShadowMaps.cpp'),
+	maek.CPP('DepthProgram.cpp'),
 	//maek.CPP('ColorTextureProgram.cpp'),  //not used right now, but you might want it
 	maek.CPP('Sound.cpp'),
 	maek.CPP('load_wav.cpp'),
 	maek.CPP('load_opus.cpp')
 ];
 
+//core (no GL/SDL): job system and file access, shared by the game, viewers, and tools:
+const core_names = [
+	maek.CPP('Jobs.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('read_write_chunk.cpp'),
+	maek.CPP('SceneFile.cpp')
+];
+
 const common_names = [
+	...core_names,
 	maek.CPP('data_path.cpp'),
 	maek.CPP('PathFont.cpp'),
 	maek.CPP('PathFont-font.cpp'),
 	maek.CPP('DrawLines.cpp'),
 	maek.CPP('ColorProgram.cpp'),
+	maek.CPP('ThickLinesProgram.cpp'),
 	maek.CPP('Scene.cpp'),
+	maek.CPP('UniformBlocks.cpp'),
 	maek.CPP('Mesh.cpp'),
 	maek.CPP('load_save_png.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
+	maek.CPP('Profiler.cpp'),
+	maek.CPP('HeadlessGL.cpp'),
+	maek.CPP('HotReload.cpp'),
 	maek.CPP('Load.cpp')
 ];
 
@@ -172,6 +193,32 @@ const show_scene_names = [
 	maek.CPP('ShowSceneMode.cpp')
 ];
 
+//battle rules (no GL/SDL), shared by the game and battle-sim:
+const battle_names = [
+	maek.CPP('Battle.cpp'),
+	maek.CPP('BattleData.cpp')
+];
+
+const battle_sim_names = [
+	maek.CPP('battle-sim.cpp')
+];
+
+const compile_characters_names = [
+	maek.CPP('compile-characters.cpp')
+];
+
+const simplify_meshes_names = [
+	maek.CPP('simplify-meshes.cpp')
+];
+
+const convert_scene_names = [
+	maek.CPP('convert-scene.cpp')
+];
+
+const jobs_bench_names = [
+	maek.CPP('jobs-bench.cpp')
+];
+
 const freetype_test_names = [
 	maek.CPP('freetype-test.cpp')
 ];
@@ -180,14 +227,19 @@ const freetype_test_names = [
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
 //returns exeFile: exeFileBase + a platform-dependant suffix (e.g., '.exe' on windows)
-const game_exe = maek.LINK([...game_names, ...common_names], 'dist/game');
+const game_exe = maek.LINK([...game_names, ...battle_names, ...common_names], 'dist/game');
 const show_meshes_exe = maek.LINK([...show_meshes_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
 
+const battle_sim_exe = maek.LINK([...battle_sim_names, ...battle_names, ...core_names], 'battle-sim');
+const compile_characters_exe = maek.LINK([...compile_characters_names, ...battle_names, ...core_names], 'scenes/compile-characters');
+const simplify_meshes_exe = maek.LINK([...simplify_meshes_names, ...core_names], 'scenes/simplify-meshes');
+const convert_scene_exe = maek.LINK([...convert_scene_names, ...core_names], 'scenes/convert-scene');
+const jobs_bench_exe = maek.LINK([...jobs_bench_names, ...core_names], 'jobs-bench');
 const freetype_test_exe = maek.LINK([...freetype_test_names], 'freetype-test');
 
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, freetype_test_exe, ...copies];
+maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, battle_sim_exe, compile_characters_exe, simplify_meshes_exe, convert_scene_exe, jobs_bench_exe, freetype_test_exe, ...copies];
 
 //the '[targets =] RULE(targets, prerequisites[, recipe])' rule defines a Makefile-style task
 // targets: array of targets the task produces (can include both files and ':abstract targets')
@@ -195,7 +247,7 @@ maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, freetype_test_exe, ..
 // recipe (optional): array of commands to run (where each command is an array [exe, arg1, arg0, ...])
 //returns targets: the targets the rule produces
 maek.RULE([':run'], [game_exe], [
-	[game_exe, '--some-command-line-option']
+	[game_exe] //(main rejects unknown options, so pass only real ones here, e.g. '--hot-reload')
 ]);
 
 //Note that tasks that produce ':abstract targets' are never cached.
@@ -0,0 +1,88 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string const &filename_) : filename(filename_) {
+	#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size != 0) { //(zero-length files can't be mapped, but they're also trivially empty)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) data = reinterpret_cast< char const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	CloseHandle(file); //(the mapping keeps the file open)
+	if (size != 0 && !data) {
+		if (mapping) CloseHandle(mapping);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size != 0) { //(zero-length files can't be mapped, but they're also trivially empty)
+		void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map '" + filename + "'.");
+		}
+		data = reinterpret_cast< char const * >(ptr);
+	}
+	close(fd); //(the mapping keeps the file open)
+	#endif
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+	if (this == &other) return *this;
+	unmap();
+	filename = std::move(other.filename);
+	data = other.data;
+	size = other.size;
+	other.data = nullptr;
+	other.size = 0;
+	#if defined(_WIN32)
+	mapping = other.mapping;
+	other.mapping = nullptr;
+	#endif
+	return *this;
+}
+
+void MappedFile::unmap() {
+	#if defined(_WIN32)
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	mapping = nullptr;
+	#else
+	if (data) munmap(const_cast< char * >(data), size);
+	#endif
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * A MappedFile maps a whole file read-only into memory (mmap / MapViewOfFile),
+ * so data files can be used in place instead of being copied through a stream.
+ *
+ * The mapping starts on a page boundary, so chunks in the file are as aligned
+ * as their offsets within the file.
+ *
+ */
+
+#include <cstddef>
+#include <string>
+
+struct MappedFile {
+	//map 'filename'; throws on failure:
+	explicit MappedFile(std::string const &filename);
+	~MappedFile();
+
+	//no copying (owns a mapping), but can be moved:
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+	MappedFile(MappedFile &&);
+	MappedFile &operator=(MappedFile &&);
+
+	char const *begin() const { return data; }
+	char const *end() const { return data + size; }
+
+	std::string filename;
+	char const *data = nullptr;
+	size_t size = 0;
+
+private:
+	void unmap();
+	#if defined(_WIN32)
+	void *mapping = nullptr; //file mapping HANDLE
+	#endif
+};
@@ -4,7 +4,6 @@
 #include <glm/glm.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -12,9 +11,15 @@
 #include <cstddef>
 
 MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
+	upload(read(filename));
+}
+
+MeshBuffer::Contents MeshBuffer::read(std::string const &filename) {
+	Contents ret;
 
-	std::ifstream file(filename, std::ios::binary);
+	//chunks are found by magic number (others are skipped), and vertices are copied once, straight from the mapping:
+	MappedFile file(filename);
+	ChunkReader chunks(file);
 
 	GLuint total = 0;
 
@@ -25,30 +30,31 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		glm::vec2 TexCoord;
 	};
 	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
+	Vertex const *data = nullptr;
 
-	//read + upload data chunk:
+	//read data chunk:
 	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+		size_t count = 0;
+		data = chunks.view< Vertex >(chunks.get("pnct"), &count);
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		//keep bytes for upload:
+		ret.vertex_data.assign(reinterpret_cast< char const * >(data), reinterpret_cast< char const * >(data + count));
 
-		total = GLuint(data.size()); //store total for later checks on index
+		total = GLuint(count); //store total for later checks on index
 
 		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+		ret.Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+		ret.Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+		ret.Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		ret.TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	size_t string_count = 0;
+	char const *strings = chunks.view< char >(chunks.get("str0"), &string_count);
+
+	std::vector< std::string > index_names; //names of index entries, in order (for lod0 entries to refer to)
 
 	{ //read index chunk, add to meshes:
 		struct IndexEntry {
@@ -58,16 +64,16 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
 		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		chunks.read(chunks.get("idx0"), &index);
 
 		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= string_count)) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			std::string name(strings + entry.name_begin, strings + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
@@ -76,26 +82,80 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 				mesh.min = glm::min(mesh.min, data[v].Position);
 				mesh.max = glm::max(mesh.max, data[v].Position);
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
+			bool inserted = ret.meshes.insert(std::make_pair(name, mesh)).second;
 			if (!inserted) {
 				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
 			}
+			index_names.emplace_back(name);
 		}
 	}
 
-	if (file.peek() != EOF) {
-		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
+	//optional chunk of coarser levels of detail (written by simplify-meshes):
+	if (ChunkReader::Chunk const *lod0 = chunks.find("lod0")) {
+		struct LODEntry {
+			uint32_t mesh; //index of idx0 entry
+			uint32_t vertex_begin, vertex_end;
+			float error;
+		};
+		static_assert(sizeof(LODEntry) == 16, "LOD entry should be packed");
+
+		std::vector< LODEntry > lods;
+		chunks.read(*lod0, &lods);
+
+		for (auto const &entry : lods) {
+			if (entry.mesh >= index_names.size()) {
+				throw std::runtime_error("lod entry refers to out-of-range mesh");
+			}
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+				throw std::runtime_error("lod entry has out-of-range vertex start/count");
+			}
+			Mesh &mesh = ret.meshes.at(index_names[entry.mesh]);
+			if (mesh.lod_count == Mesh::MaxLODs) {
+				std::cerr << "WARNING: ignoring extra levels of detail for mesh '" << index_names[entry.mesh] << "' in '" << filename << "'." << std::endl;
+				continue;
+			}
+			Mesh::LOD &lod = mesh.lods[mesh.lod_count++];
+			lod.start = entry.vertex_begin;
+			lod.count = entry.vertex_end - entry.vertex_begin;
+			lod.error = entry.error;
+		}
 	}
 
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
-	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
+	for (auto const &m : ret.meshes) {
+		if (&m.second == &ret.meshes.rbegin()->second && ret.meshes.size() > 1) std::cout << " and";
 		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+		if (&m.second != &ret.meshes.rbegin()->second) std::cout << ",";
 	}
 	std::cout << std::endl;
 	*/
+
+	return ret;
+}
+
+void MeshBuffer::upload(Contents &&contents) {
+	if (buffer != 0) {
+		//VAOs made by make_vao_for_program() bake in the vertex format, so a reload must keep it:
+		auto same = [](Attrib const &a, Attrib const &b) {
+			return a.size == b.size && a.type == b.type && a.normalized == b.normalized && a.stride == b.stride && a.offset == b.offset;
+		};
+		if (!(same(Position, contents.Position) && same(Normal, contents.Normal) && same(Color, contents.Color) && same(TexCoord, contents.TexCoord))) {
+			throw std::runtime_error("Reloaded mesh data has a different vertex format than the data it replaces.");
+		}
+	} else {
+		glGenBuffers(1, &buffer);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, contents.vertex_data.size(), contents.vertex_data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	Position = contents.Position;
+	Normal = contents.Normal;
+	Color = contents.Color;
+	TexCoord = contents.TexCoord;
+	meshes = std::move(contents.meshes);
 }
 
 const Mesh &MeshBuffer::lookup(std::string const &name) const {
@@ -14,6 +14,7 @@
 #include <map>
 #include <limits>
 #include <string>
+#include <vector>
 
 
 struct Mesh {
@@ -23,10 +24,26 @@ struct Mesh {
 	GLuint start = 0; //index of first vertex
 	GLuint count = 0; //count of vertices
 
+	//Coarser versions of the mesh (finest first), if the file has them (see simplify-meshes.cpp):
+	enum : uint32_t { MaxLODs = 4 };
+	struct LOD {
+		GLuint start = 0; //index of first vertex
+		GLuint count = 0; //count of vertices
+		float error = 0.0f; //how far (object space) this version's surface may stray from the full mesh
+	};
+	uint32_t lod_count = 0;
+	LOD lods[MaxLODs];
+
 	//Bounding box.
 	//useful for debug visualization and (perhaps, eventually) collision detection:
 	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
 	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	//sphere (center, radius) around the bounding box, with negative radius if the mesh is empty:
+	glm::vec4 bounding_sphere() const {
+		if (!(min.x <= max.x && min.y <= max.y && min.z <= max.z)) return glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+		return glm::vec4(0.5f * (min + max), 0.5f * glm::length(max - min));
+	}
 };
 
 struct MeshBuffer {
@@ -67,4 +84,18 @@ struct MeshBuffer {
 	Attrib Normal;
 	Attrib Color;
 	Attrib TexCoord;
+
+	//Loading is split in two so files can be read off the main thread (e.g., for hot reloading):
+	//the contents of a mesh file, read without making any GL calls:
+	struct Contents {
+		std::vector< char > vertex_data;
+		Attrib Position, Normal, Color, TexCoord;
+		std::map< std::string, Mesh > meshes;
+	};
+	// note: will throw if file fails to read (or fails its checksums; see ChunkReader).
+	static Contents read(std::string const &filename);
+
+	//upload contents (needs GL); when replacing earlier contents, keeps the same buffer name so existing VAOs stay valid:
+	// note: will throw if the vertex format differs from the contents being replaced.
+	void upload(Contents &&contents);
 };
@@ -13,12 +13,16 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//The function should return 'true' if it handled the event.
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) { return false; }
 
-	//update is called at the start of a new frame, after events are handled:
+	//update is called after events are handled:
 	// 'elapsed' is time in seconds since the last call to 'update'
+	// (the game calls update zero or more times per frame with a fixed 'elapsed' of one tick)
 	virtual void update(float elapsed) { }
 
 	//draw is called after update:
-	virtual void draw(glm::uvec2 const &drawable_size) = 0;
+	// 'alpha' in [0,1) is how far real time is between the last update and the next one;
+	// use it to interpolate between the two most recent simulation states.
+	// (with a variable step, as in the viewers, state is always current and alpha is 1)
+	virtual void draw(glm::uvec2 const &drawable_size, float alpha) = 0;
 
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
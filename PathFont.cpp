@@ -4,6 +4,7 @@
 #include "PathFont.hpp"
 
 #include <iostream>
+#include <cassert>
 
 PathFont::PathFont(uint32_t glyphs_,
 	const float *glyph_widths_,
@@ -14,11 +15,88 @@ PathFont::PathFont(uint32_t glyphs_,
 		glyph_char_starts(glyph_char_starts_), chars(chars_),
 		glyph_coord_starts(glyph_coord_starts_), coords(coords_) {
 
+	byte_glyphs.fill(-1U);
+
+	//trie is built with per-node child maps, then flattened into trie_edges below:
+	std::vector< std::map< uint8_t, uint32_t > > children;
+	trie_nodes.emplace_back();
+	children.emplace_back();
+
 	for (uint32_t i = 0; i < glyphs; ++i) {
 		std::string str(reinterpret_cast< const char * >(chars + glyph_char_starts[i]), reinterpret_cast< const char * >(chars + glyph_char_starts[i+1]));
 		auto res = glyph_map.insert(std::make_pair(str, i));
 		if (!res.second) {
 			std::cerr << "WARNING: ignoring duplicate glyph for '" << str << "'." << std::endl;
+			continue;
+		}
+		if (str.empty()) continue; //can't ever match an empty glyph
+
+		if (str.size() == 1) {
+			byte_glyphs[uint8_t(str[0])] = i;
+			continue;
+		}
+
+		uint32_t node = 0;
+		for (char c : str) {
+			auto f = children[node].find(uint8_t(c));
+			if (f == children[node].end()) {
+				f = children[node].emplace(uint8_t(c), uint32_t(trie_nodes.size())).first;
+				trie_nodes.emplace_back();
+				children.emplace_back();
+			}
+			node = f->second;
+		}
+		trie_nodes[node].glyph = i;
+	}
+
+	for (uint32_t n = 0; n < trie_nodes.size(); ++n) {
+		trie_nodes[n].edges_begin = uint32_t(trie_edges.size());
+		for (auto const &child : children[n]) {
+			trie_edges.emplace_back();
+			trie_edges.back().byte = child.first;
+			trie_edges.back().node = child.second;
+		}
+		trie_nodes[n].edges_end = uint32_t(trie_edges.size());
+	}
+
+	//single-byte glyphs live in byte_glyphs, but may also be prefixes of multi-byte glyphs:
+	for (uint32_t e = trie_nodes[0].edges_begin; e < trie_nodes[0].edges_end; ++e) {
+		trie_nodes[trie_edges[e].node].glyph = byte_glyphs[trie_edges[e].byte];
+	}
+}
+
+uint32_t PathFont::match(char const *begin, char const *end, uint32_t *glyph_out) const {
+	assert(glyph_out);
+	*glyph_out = -1U;
+	if (begin == end) return 0;
+
+	uint32_t length = 0;
+	if (byte_glyphs[uint8_t(*begin)] != -1U) {
+		*glyph_out = byte_glyphs[uint8_t(*begin)];
+		length = 1;
+	}
+
+	//no multi-byte glyphs in this font:
+	if (trie_edges.empty()) return length;
+
+	uint32_t node = 0;
+	for (char const *c = begin; c != end; ++c) {
+		//binary search for the child edge labeled with *c:
+		uint32_t lo = trie_nodes[node].edges_begin;
+		uint32_t hi = trie_nodes[node].edges_end;
+		while (lo < hi) {
+			uint32_t mid = (lo + hi) / 2;
+			if (trie_edges[mid].byte < uint8_t(*c)) lo = mid + 1;
+			else hi = mid;
+		}
+		if (lo == trie_nodes[node].edges_end || trie_edges[lo].byte != uint8_t(*c)) break;
+		node = trie_edges[lo].node;
+
+		if (trie_nodes[node].glyph != -1U) {
+			*glyph_out = trie_nodes[node].glyph;
+			length = uint32_t(c - begin) + 1;
 		}
 	}
+
+	return length;
 }
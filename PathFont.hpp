@@ -10,6 +10,7 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
 #include <string>
 #include <vector>
 #include <map>
@@ -33,6 +34,28 @@ struct PathFont {
 	//computed in constructor:
 	std::map< std::string, uint32_t > glyph_map;
 
+	//find the longest glyph whose characters are a prefix of [begin,end):
+	// returns the number of bytes matched (0 if no glyph matches) and sets *glyph_out.
+	// (does not allocate; used by DrawLines::draw_text)
+	uint32_t match(char const *begin, char const *end, uint32_t *glyph_out) const;
+
+	//flat lookup tables used by match(), also computed in constructor:
+	//single-byte glyphs are looked up directly by byte value (-1U if no glyph):
+	std::array< uint32_t, 256 > byte_glyphs;
+
+	//multi-byte glyphs are stored in a trie; trie_nodes[0] is the root:
+	struct TrieNode {
+		uint32_t glyph = -1U; //glyph ending at this node (or -1U)
+		uint32_t edges_begin = 0; //children are trie_edges[edges_begin,edges_end), sorted by byte
+		uint32_t edges_end = 0;
+	};
+	struct TrieEdge {
+		uint8_t byte = 0;
+		uint32_t node = 0;
+	};
+	std::vector< TrieNode > trie_nodes;
+	std::vector< TrieEdge > trie_edges;
+
 	//the default font:
 	static PathFont font;
 };
@@ -2,14 +2,22 @@
 
 #include "LitColorTextureProgram.hpp"
 #include "ColorTextureProgram.hpp"
+#include "DepthProgram.hpp"
 #include <istream>
+#include <fstream>
 #include <chrono>
 #include <thread>
 
 #include <iostream>     // std::cin, std::cout
+#include "BattleData.hpp"
 #include "DrawLines.hpp"
-// #include "TextRenderer.hpp"
-#include "shader.hpp"
+#include "DrawUI.hpp"
+#include "GlyphAtlas.hpp"
+#include "HotReload.hpp"
+#include "TextLayout.hpp"
+#include "UniformBlocks.hpp"
+#include "gl_stats.hpp"
+#include "Profiler.hpp"
 #include "Mesh.hpp"
 #include "Load.hpp"
 #include "gl_errors.hpp"
@@ -17,25 +25,50 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
 #include <random>
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 GLuint game_scene_meshes_for_lit_color_texture_program = 0;
 Load< MeshBuffer > game_meshes(LoadTagDefault, []() -> MeshBuffer const * {
-	MeshBuffer const *ret = new MeshBuffer(data_path("game-scene.pnct"));
+	MeshBuffer *ret = new MeshBuffer(data_path("game-scene.pnct"));
 	game_scene_meshes_for_lit_color_texture_program = ret->make_vao_for_program(lit_color_texture_program->program);
+
+	//on change, read on the watcher thread and re-upload into the same buffer (so the vao above stays valid):
+	HotReload::watch({data_path("game-scene.pnct")}, [ret]() -> HotReload::Commit {
+		auto contents = std::make_shared< MeshBuffer::Contents >(MeshBuffer::read(data_path("game-scene.pnct")));
+		return [ret, contents](){ ret->upload(std::move(*contents)); };
+	});
+
 	return ret;
 });
 
-Load< Scene > game_scene(LoadTagDefault, []() -> Scene const * {
-	return new Scene(data_path("game-scene.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
+//game-scene.scene as read from disk, before any meshes are attached:
+// (reading doesn't touch meshes or GL, so a hot reload can do it on the watcher thread)
+struct GameSceneFile {
+	Scene scene;
+	std::vector< std::pair< Scene::Transform *, std::string > > meshes; //transform and mesh name of each drawable, in file order
+};
+
+static std::shared_ptr< GameSceneFile > read_game_scene() {
+	auto ret = std::make_shared< GameSceneFile >();
+	ret->scene.load(data_path("game-scene.scene"), [&](Scene &, Scene::Transform *transform, std::string const &mesh_name){
+		ret->meshes.emplace_back(transform, mesh_name);
+	});
+	if (ret->scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(ret->scene.cameras.size()));
+	return ret;
+}
+
+//attach drawables for the meshes read by read_game_scene and flatten the result:
+// (reads game_meshes and lit_color_texture_program, so this runs on the main thread)
+static Scene::Snapshot make_game_scene(GameSceneFile &file) {
+	for (auto const &[transform, mesh_name] : file.meshes) {
 		Mesh const &mesh = game_meshes->lookup(mesh_name);
 
-		scene.drawables.emplace_back(transform);
-		Scene::Drawable &drawable = scene.drawables.back();
+		file.scene.drawables.emplace_back(transform);
+		Scene::Drawable &drawable = file.scene.drawables.back();
 
 		drawable.pipeline = lit_color_texture_program_pipeline;
 
@@ -43,187 +76,242 @@ Load< Scene > game_scene(LoadTagDefault, []() -> Scene const * {
 		drawable.pipeline.type = mesh.type;
 		drawable.pipeline.start = mesh.start;
 		drawable.pipeline.count = mesh.count;
+		drawable.bounding_sphere = mesh.bounding_sphere();
+		drawable.lod_count = std::min(mesh.lod_count, uint32_t(Scene::Drawable::MaxLODs));
+		for (uint32_t l = 0; l < drawable.lod_count; ++l) {
+			drawable.lods[l].start = mesh.lods[l].start;
+			drawable.lods[l].count = mesh.lods[l].count;
+			drawable.lods[l].error = mesh.lods[l].error;
+		}
+	}
+	return file.scene.snapshot();
+}
+
+//add the drawables and lights requested in 'options' to the scene (scattered things are repeatable for a given seed):
+static void add_scene_options(Scene &scene, PlayOptions const &options, uint64_t seed) {
+	if (options.extra_drawables && !scene.drawables.empty()) {
+		//copies of the scene's drawables, placed around (and a good way past) the originals:
+		std::vector< Scene::Drawable const * > originals;
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (auto const &drawable : scene.drawables) {
+			originals.emplace_back(&drawable);
+			glm::vec3 at = drawable.transform->make_local_to_world()[3];
+			min = glm::min(min, at);
+			max = glm::max(max, at);
+		}
+		glm::vec3 center = 0.5f * (min + max);
+		glm::vec3 half = glm::vec3(2.0f) * glm::max(0.5f * (max - min), glm::vec3(1.0f));
+		half.z = std::max(0.5f * (max.z - min.z), 0.0f); //(stay at the scene's heights)
+
+		Random rng(seed, 4);
+		for (uint32_t i = 0; i < options.extra_drawables; ++i) {
+			Scene::Drawable const &original = *originals[rng.next() % originals.size()];
+			scene.transforms.emplace_back();
+			Scene::Transform &transform = scene.transforms.back();
+			transform.name = "scattered drawable " + std::to_string(i);
+			transform.position = center + half * glm::vec3(2.0f * rng.next_float() - 1.0f, 2.0f * rng.next_float() - 1.0f, 2.0f * rng.next_float() - 1.0f);
+			transform.rotation = glm::angleAxis(glm::radians(360.0f) * rng.next_float(), glm::vec3(0.0f, 0.0f, 1.0f));
+			transform.scale = original.transform->scale;
+
+			scene.drawables.emplace_back(original);
+			scene.drawables.back().transform = &transform;
+		}
+	}
 
+	if (options.sun) {
+		scene.transforms.emplace_back();
+		Scene::Transform &transform = scene.transforms.back();
+		transform.name = "sun";
+		//tilted down from straight overhead so shadows fall to the side:
+		transform.rotation = glm::angleAxis(glm::radians(40.0f), glm::normalize(glm::vec3(1.0f, 0.5f, 0.0f)));
+
+		scene.lights.emplace_back(&transform);
+		Scene::Light &light = scene.lights.back();
+		light.type = Scene::Light::Directional;
+		light.energy = glm::vec3(1.0f, 0.95f, 0.85f);
+	}
+
+	uint32_t count = options.extra_lights;
+	if (count == 0 || scene.drawables.empty()) return;
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (auto const &drawable : scene.drawables) {
+		glm::vec3 at = drawable.transform->make_local_to_world()[3];
+		min = glm::min(min, at);
+		max = glm::max(max, at);
+	}
+	min -= glm::vec3(1.0f);
+	max += glm::vec3(1.0f);
+
+	Random rng(seed, 3);
+	for (uint32_t i = 0; i < count; ++i) {
+		scene.transforms.emplace_back();
+		Scene::Transform &transform = scene.transforms.back();
+		transform.name = "scattered light " + std::to_string(i);
+		transform.position = min + (max - min) * glm::vec3(rng.next_float(), rng.next_float(), rng.next_float());
+
+		scene.lights.emplace_back(&transform);
+		Scene::Light &light = scene.lights.back();
+		light.type = Scene::Light::Point;
+		light.energy = 4.0f * glm::vec3(rng.next_float(), rng.next_float(), rng.next_float());
+		light.distance = 2.0f + 2.0f * rng.next_float();
+	}
+}
+
+//incremented when game_scene is reloaded, so PlayMode knows to re-copy it:
+static uint32_t game_scene_generation = 0;
+
+//kept as a snapshot, so each PlayMode's copy is restored by index rather than copied node-by-node (see Scene::Snapshot):
+Load< Scene::Snapshot > game_scene(LoadTagDefault, []() -> Scene::Snapshot const * {
+	Scene::Snapshot *ret = new Scene::Snapshot(make_game_scene(*read_game_scene()));
+
+	//drawables copy mesh ranges and uniform locations, so rebuild the scene when meshes or the program change, too:
+	// (the file is read on the watcher thread; drawables are attached in the commit, after meshes and program have been committed, since attaching reads them)
+	HotReload::watch({
+		data_path("game-scene.scene"), data_path("game-scene.pnct"),
+		data_path("lit_color_texture.vs"), data_path("lit_color_texture.fs")
+	}, [ret]() -> HotReload::Commit {
+		std::shared_ptr< GameSceneFile > file = read_game_scene();
+		return [ret, file](){
+			*ret = make_game_scene(*file);
+			game_scene_generation += 1;
+		};
 	});
+
+	return ret;
+});
+
+Load< GlyphAtlas > hud_atlas(LoadTagDefault, []() -> GlyphAtlas const * {
+	return new GlyphAtlas(data_path("Roboto-Regular.ttf"), 48);
 });
 
-Load< Sound::Sample > p1_toast_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("Toast_Move.wav"));
+Load< BattleData > battle_data(LoadTagDefault, []() -> BattleData const * {
+	return new BattleData(data_path("characters.battle"));
+});
+
+//load a sample whose data is swapped in place (see Sound::replace_data) when its file changes:
+// (decoding needs no GL, so samples load as LoadTagJob, in parallel with each other and with the GL loads)
+static Sound::Sample const *load_sample(std::string const &filename) {
+	Sound::Sample const *ret = new Sound::Sample(filename);
+	HotReload::watch({filename}, [ret, filename]() -> HotReload::Commit {
+		auto fresh = std::make_shared< Sound::Sample >(filename); //(decoded on the watcher thread)
+		return [ret, fresh](){ Sound::replace_data(*ret, std::move(fresh->data)); };
+	});
+	return ret;
+}
+
+Load< Sound::Sample > p1_toast_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("Toast_Move.wav"));
 });
-Load< Sound::Sample > p1_rap_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("Rap_Move.wav"));
+Load< Sound::Sample > p1_rap_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("Rap_Move.wav"));
 });
-Load< Sound::Sample > p1_miss_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("p1miss.wav"));
+Load< Sound::Sample > p1_miss_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("p1miss.wav"));
 });
-Load< Sound::Sample > p1_hit_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("p1hit.wav"));
+Load< Sound::Sample > p1_hit_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("p1hit.wav"));
 });
-Load< Sound::Sample > p2_tackle_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("tackle.wav"));
+Load< Sound::Sample > p2_tackle_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("tackle.wav"));
 });
-Load< Sound::Sample > p2_call_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("bread.wav"));
+Load< Sound::Sample > p2_call_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("bread.wav"));
 });
-Load< Sound::Sample > p2_hit_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("p2hit.wav"));
+Load< Sound::Sample > p2_hit_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("p2hit.wav"));
 });
-Load< Sound::Sample > p2_miss_sample(LoadTagDefault, []() -> Sound::Sample const * {
-	return new Sound::Sample(data_path("p2miss.wav"));
+Load< Sound::Sample > p2_miss_sample(LoadTagJob, []() -> Sound::Sample const * {
+	return load_sample(data_path("p2miss.wav"));
 });
 
 
-int Attack::activate(Player *user, Player *target) {
-	int damage_done = base_damage;
-	std::mt19937 mt(std::time(nullptr));
-	// check if move hits
-	float accuracy_roll = float(mt()) / float(mt.max());
-	if (accuracy_roll > accuracy){
-		user->damage_dealt = 0;
-		return 0;
-	}
-
-	// check for crit
-	float crit_roll = float(mt()) / float(mt.max());
-	bool was_crit = crit_roll <= crit_chance;
-	if (was_crit)
-		damage_done *= 2;
-	// random damage variance
-	int rand_dmg_range = Attack::dmg_variance_range * damage_done;
-	damage_done += ((int(mt()) % (2 * rand_dmg_range)) - rand_dmg_range);
-	user->damage_dealt = std::max(1, damage_done);
-	target->cur_health -= user->damage_dealt;
-
-	// apply damage
-	return std::max(1, damage_done);
-}
-
-int Heal::activate(Player *user, Player *target) {
-	std::mt19937 mt(std::time(nullptr));
-	// check if move hits
-	float accuracy_roll = float(mt()) / float(mt.max());
-	if (accuracy_roll > accuracy)
-		return 0;
-	// Heal for half of the target's max health
-	return std::max(1, (int)((float)(target->max_health) * percent_heal));
-}
+void benchmark_scene_clone(PlayOptions const &options, uint64_t seed, uint32_t trials) {
+	Scene source;
+	source.restore(*game_scene);
+	add_scene_options(source, options, seed);
 
-Player::Player(unsigned int start_health) {
-	max_health = start_health;
-	cur_health = start_health;
+	//best-of-'trials' milliseconds that 'fn' takes:
+	auto time_best = [trials](std::function< void() > const &fn) {
+		double best = std::numeric_limits< double >::infinity();
+		for (uint32_t t = 0; t < trials; ++t) {
+			auto before = std::chrono::high_resolution_clock::now();
+			fn();
+			auto after = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration< double, std::milli >(after - before).count());
+		}
+		return best;
+	};
+
+	Scene::Snapshot snapshot = source.snapshot();
+	Scene instance;
+	instance.restore(snapshot);
+
+	//(copies are freed inside the timed functions, as a scene copied per battle would be)
+	double set_ms = time_best([&](){ Scene copy; copy.set(source); });
+	double snapshot_ms = time_best([&](){ source.snapshot(); });
+	double rebuild_ms = time_best([&](){ Scene copy; copy.restore(snapshot); });
+	double in_place_ms = time_best([&](){ instance.restore(snapshot); });
+
+	std::cout << "Cloning a scene of " << source.transforms.size() << " transforms, " << source.drawables.size() << " drawables, "
+		<< source.cameras.size() << " cameras, and " << source.lights.size() << " lights (best of " << trials << "):\n";
+	std::cout << "  Scene::set:                  " << set_ms << " ms\n";
+	std::cout << "  Scene::snapshot:             " << snapshot_ms << " ms\n";
+	std::cout << "  Scene::restore (new scene):  " << rebuild_ms << " ms\n";
+	std::cout << "  Scene::restore (in place):   " << in_place_ms << " ms" << std::endl;
 }
 
-PlayMode::PlayMode() : scene(*game_scene), shader(data_path("text.vs").c_str(), data_path("text.fs").c_str()) {
-	
-	cur_phase = DECIDING;
-
-	/**/
-	Attack rap = Attack("Rap", 15, 10.f, 1.f);
-	Attack roast = Attack("Roast", 5, 10.f, 7.f);
-	roast.name = "Roast";
-	rap.name = "Rap";
-	
-
-	Attack tackle = Attack("Loaf", 10, 10.f, 1.f);
-	Attack call = Attack("Roll Call", 15, 10.f, 5.f);
-	tackle.name = "Loaf";
-	call.name = "Roll Call";
+PlayMode::PlayMode(uint64_t seed_, PlayOptions const &options_) : options(options_), seed(seed_) {
+	scene.restore(*game_scene);
 
-	player1.moves.push_back(rap);
-	player1.moves.push_back(roast);
-
-	player2.moves.push_back(tackle);
-	player2.moves.push_back(call);
+	start_battle();
 
 	// dialogue.push_back({"Hello world", "pls end me", "live laugh love"}); 
 	// dialogue.push_back({"You are now dead","yay","damn"});
 	// dialogue.push_back({"You're a basic white girl","#JustGirlyTings", "#Slayyy"});
 
 	//get pointer to camera for convenience:
-	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
+	// (read_game_scene checks there is exactly one)
 	camera = &scene.cameras.front();
+	scene_generation = game_scene_generation;
+	add_scene_options(scene, options, seed);
+	reset_scene_start();
+
+	shadow_maps.cache = options.shadow_cache;
 
 	//start music loop playing:
 	// (note: position will be over-ridden in update())
 	// leg_tip_loop = Sound::loop_3D(*dusty_floor_sample, 1.0f, get_leg_tip_position(), 10.0f);
 
-	// shader = Shader(data_path("text.vs"), data_path("text.fs"));
-
 	// OpenGL state
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	shader.use();
-	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glEnable(GL_CULL_FACE);
+}
 
-	// FreeType
-	if (FT_Init_FreeType(&ft)) {
-		std::cerr << "Error initializing FreeType Library" << std::endl;
-		return;
-	}
-	std::string font_name = data_path("Roboto-Regular.ttf");
-	if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
-		std::cerr << "Error loading freetype font face" << std::endl;
-		return;
-	}
-	FT_Set_Pixel_Sizes(face, 0, 48);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	// TEMP: LOAD FRST 128 CHARS OF ASCII SET
-	for (unsigned char c = 0; c < 128; c++) {
-		// Load character glyph
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-			std::cerr << "Error loading glyph " << c << std::endl;
-			continue;
-		}
-		// Generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		// now store character for later use
-		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			static_cast<unsigned int>(face->glyph->advance.x)
-		};
-		Characters.insert(std::pair<char, Character>(c, character));
-	}
-	glBindTexture(GL_TEXTURE_2D, 0);
-	FT_Done_Face(face);
-	FT_Done_FreeType(ft);
-	// configure VAO/VBO for texture quds
-	// =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+PlayMode::~PlayMode() {
+}
 
+void PlayMode::reset_scene_start() {
+	scene_start = scene.snapshot();
+	scene.layout = scene_start.layout; //(the scene is exactly that layout, so rematches restore in place)
 }
 
-PlayMode::~PlayMode() {
+void PlayMode::start_battle() {
+	cur_phase = DECIDING;
+	outcome = TurnResult::Ongoing;
+	tick = tick2 = 0.0f;
+	player1_done_speaking = false;
+
+	player1 = Player();
+	player2 = Player();
+	static_cast< Combatant & >(player1) = battle_data->lookup("Toast");
+	static_cast< Combatant & >(player2) = battle_data->lookup("Bread");
+	player1_rng = Random(seed, 1);
+	player2_rng = Random(seed, 2);
+	std::cout << "Battle seed: " << seed << std::endl;
+
+	snapshot.health = glm::vec2(player1.cur_health, player2.cur_health);
+	prev_snapshot = snapshot;
 }
 
 void PlayMode::load_dialogue(std::string filename){
@@ -297,6 +385,9 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 			space.downs += 1;
 			space.pressed = true;
 			return true;
+		} else if (evt.key.keysym.sym == SDLK_F1) {
+			show_stats = !show_stats;
+			return true;
 		}
 	} else if (evt.type == SDL_KEYUP) {
 		if (evt.key.keysym.sym == SDLK_a) {
@@ -353,8 +444,6 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 }
 
 void PlayMode::update_deciding(float elapsed) {
-	std::shared_ptr< Sound::PlayingSample >  sample1;
-	std::shared_ptr< Sound::PlayingSample >  sample2;
 	// if both players have made a move, then progress to the next phase
 	if (!player1.is_deciding && !player2.is_deciding) {
 		if (player1.move_selected == -1)
@@ -363,63 +452,45 @@ void PlayMode::update_deciding(float elapsed) {
 			std::cerr << "Error: player 2 is not deciding but move selected is -1!" << std::endl;
 		// TODO: change to animating if we make an animating phase
 		tick += elapsed;
-		while (tick > 3.00f) {
-			tick -= 3.00f;
-		
-		//  std::this_thread::sleep_until(std::chrono::system_clock::now() + std::chrono::seconds(1));
+		if (tick > 3.00f) {
+			tick = 0.0f;
+
+			//resolve the turn now, so the report shows its results:
+			float rolls1[MoveRolls], rolls2[MoveRolls];
+			player1_rng.fill_floats(rolls1, MoveRolls);
+			player2_rng.fill_floats(rolls2, MoveRolls);
+			TurnResult result = resolve_turn(player1, player1.move_selected, rolls1, player2, player2.move_selected, rolls2);
+			player1.damage_dealt = result.a.damage;
+			player2.damage_dealt = result.b.damage;
+			player1.is_winner = (result.outcome == TurnResult::AWins);
+			player2.is_winner = (result.outcome == TurnResult::BWins);
+			outcome = result.outcome;
+
 			cur_phase = REPORTING;
 		}
 		return;
 	}
-	// check if players picked a move
-	if (a.pressed) {
-		if (player1.is_deciding) {
-			sample1 = Sound::play_3D(*p1_rap_sample, .9f, camera->transform->position, 10.0f);
-		}
-		while(!sample1->stopped){}
-		player1.move_selected = 0;
-		player1.is_deciding = false;
-	}
-	if (s.pressed) {
-		if (player1.is_deciding) {
-			sample1 = Sound::play_3D(*p1_toast_sample, .9f, camera->transform->position, 10.0f);
-		}
-		while(!sample1->stopped){}
-		player1.move_selected = 1;
-		player1.is_deciding = false;
-	}
-	// if (d.pressed) {
-	// 	player1.move_selected = 2;
-	// 	player1.is_deciding = false;
-	// }
-	// if (f.pressed) {
-	// 	player1.move_selected = 3;
-	// 	player1.is_deciding = false;
-	// }
-	if (j.pressed) {
-		if (player2.is_deciding){
-			sample2 = Sound::play_3D(*p2_tackle_sample, 2.0f, camera->transform->position, 10.0f);
-		}
-		while(!sample2->stopped){}
-		player2.move_selected = 0;
-		player2.is_deciding = false;
-	}
-	if (k.pressed) {
-		if (player2.is_deciding){
-			sample2 = Sound::play_3D(*p2_call_sample, 2.0f, camera->transform->position, 10.0f);
+	// check if players picked a move:
+	// the move's sound plays, and the choice is locked in when it finishes (see handle_sound_event)
+	auto pick = [this](Player &player, int move, Sound::Sample const &sample, float volume) {
+		if (!player.is_deciding || player.pending_sound != 0) return;
+		player.move_selected = move;
+		player.pending_sound = Sound::play_3D(sample, volume, camera->transform->position, 10.0f)->id;
+	};
+	if (a.pressed) pick(player1, 0, *p1_rap_sample, .9f);
+	if (s.pressed) pick(player1, 1, *p1_toast_sample, .9f);
+	if (j.pressed) pick(player2, 0, *p2_tackle_sample, 2.0f);
+	if (k.pressed) pick(player2, 1, *p2_call_sample, 2.0f);
+}
+
+void PlayMode::handle_sound_event(Sound::Event const &evt) {
+	if (evt.type != Sound::Event::Finished) return;
+	for (Player *player : {&player1, &player2}) {
+		if (player->pending_sound != 0 && player->pending_sound == evt.id) {
+			player->pending_sound = 0;
+			player->is_deciding = false;
 		}
-		while(!sample2->stopped){}
-		player2.move_selected = 1;
-		player2.is_deciding = false;
 	}
-	// if (l.pressed) {
-	// 	player2.move_selected = 2;
-	// 	player2.is_deciding = false;
-	// }
-	// if (semi.pressed) {
-	// 	player2.move_selected = 3;
-	// 	player2.is_deciding = false;
-	// }
 }
 
 void PlayMode::update_animating(float elapsed) {
@@ -428,12 +499,29 @@ void PlayMode::update_animating(float elapsed) {
 }
 
 void PlayMode::update_reporting(float elapsed) {
+	//player 1's result sound plays right away:
+	if (!player1.is_deciding) {
+		if (player1.damage_dealt > 0) Sound::play_3D(*p1_hit_sample, .5f, camera->transform->position, 10.0f);
+		else Sound::play_3D(*p1_miss_sample, .5f, camera->transform->position, 10.0f);
+	}
+	//...player 2's after a pause:
+	tick2 += elapsed;
+	while (!player1_done_speaking && tick2 > 2.00f) {
+		tick2 -= 2.00f;
+
+		if (!player2.is_deciding) {
+			if (player2.damage_dealt > 0) Sound::play_3D(*p2_hit_sample, .5f, camera->transform->position, 10.0f);
+			else Sound::play_3D(*p2_miss_sample, .5f, camera->transform->position, 10.0f);
+		}
+		player1_done_speaking = true;
+	}
+	player1.is_deciding = true;
+	if (player1_done_speaking) player2.is_deciding = true;
+
 	if (space.pressed) {
-		if (player1.is_winner || player2.is_winner)
+		if (outcome != TurnResult::Ongoing)
 			cur_phase = OVER;
 		else {
-			player1.moves[player1.move_selected].activate(&player1,&player2);
-			player2.moves[player2.move_selected].activate(&player2,&player1);
 			player1.move_selected = -1;
 			player2.move_selected = -1;
 			
@@ -444,10 +532,35 @@ void PlayMode::update_reporting(float elapsed) {
 }
 
 void PlayMode::update_over(float elapsed) {
-	// I don't think we need to do anything here.
+	//space starts a rematch (on the next seed, in the scene as it was when the first battle started):
+	if (space.downs) {
+		scene.restore(scene_start);
+		camera = &scene.cameras.front();
+		seed += 1;
+		start_battle();
+	}
 }
 
 void PlayMode::update(float elapsed) {
+	PROFILE_SCOPE("PlayMode::update");
+
+	prev_snapshot = snapshot;
+
+	if (scene_generation != game_scene_generation) {
+		//game_scene was hot reloaded; take the new copy:
+		scene.restore(*game_scene);
+		camera = &scene.cameras.front();
+		scene_generation = game_scene_generation;
+		add_scene_options(scene, options, seed);
+		reset_scene_start();
+	}
+
+	{ //react to sounds finishing (never wait on them):
+		Sound::Event evt;
+		while (Sound::poll_event(&evt)) {
+			handle_sound_event(evt);
+		}
+	}
 
 	switch (cur_phase) {
 		case DECIDING:
@@ -473,6 +586,11 @@ void PlayMode::update(float elapsed) {
 		Sound::listener.set_position_right(frame_at, frame_right, 1.0f / 60.0f);
 	}
 
+	{ //displayed health eases toward actual health:
+		glm::vec2 health = glm::vec2(player1.cur_health, player2.cur_health);
+		snapshot.health += (health - snapshot.health) * (1.0f - std::exp(-8.0f * elapsed));
+	}
+
 	//reset button press counters:
 	a.downs = 0;
 	s.downs = 0;
@@ -485,69 +603,27 @@ void PlayMode::update(float elapsed) {
 	space.downs = 0;
 }
 
-void PlayMode::render_text(std::string text, float x, float y, float scale, glm::vec3 color) {
-    // activate corresponding render state	
-    shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
-
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++) 
-    {
-        Character ch = Characters[*c];
-
-        float xpos = x + ch.Bearing.x * scale;
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },            
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }           
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
-    }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-void PlayMode::draw(glm::uvec2 const &drawable_size) {
-	auto current_time = std::chrono::high_resolution_clock::now();
-	static auto previous_time = current_time;
-	float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
-	previous_time = current_time;
+void PlayMode::draw(glm::uvec2 const &drawable_size, float alpha) {
+	//interpolate between the last two simulation states:
+	Snapshot state;
+	state.health = glm::mix(prev_snapshot.health, snapshot.health, alpha);
 
-	//if frames are taking a very long time to process,
-	//lag to avoid spiral of death:
-	elapsed = std::min(0.1f, elapsed);
 	//update camera aspect ratio for drawable:
 	camera->aspect = float(drawable_size.x) / float(drawable_size.y);
 
-	//set up light type and position for lit_color_texture_program:
-	// TODO: consider using the Light(s) in the scene to do this
-	glUseProgram(lit_color_texture_program->program);
-	glUniform1i(lit_color_texture_program->LIGHT_TYPE_int, 1);
-	glUniform3fv(lit_color_texture_program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f,-1.0f)));
-	glUniform3fv(lit_color_texture_program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
-	glUseProgram(0);
+	//levels of detail for this view (used by every pass below):
+	if (options.lod) scene.update_lods(camera->make_world_to_clip(), float(drawable_size.y));
+
+	{ //shadow maps (only re-rendered when something they show moved):
+		Profiler::GPUScope gpu("shadows");
+		shadow_maps.update(scene, *camera);
+	}
+
+	//fill light for lit_color_texture_program:
+	// (uploaded with the camera in Scene::draw; the scene's own lights are added by clustered_lights)
+	frame_block.LIGHT_TYPE = 1;
+	frame_block.LIGHT_DIRECTION = glm::vec4(0.0f, 0.0f,-1.0f, 0.0f);
+	frame_block.LIGHT_ENERGY = glm::vec4(1.0f, 1.0f, 0.95f, 0.0f);
 
 	glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
 	glClearDepth(1.0f); //1.0 is actually the default value to clear the depth buffer to, but FYI you can change it.
@@ -556,79 +632,135 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS); //this is the default depth comparison function, but FYI you can change it.
 
-	scene.draw(*camera);
-	std::string winner;
+	clustered_lights.update(scene.lights, *camera, drawable_size, &shadow_maps);
+
+	if (options.depth_prepass) {
+		//lay down depth (nearest drawables first), then shade only the surface that ends up visible in each pixel:
+		// (both programs declare gl_Position invariant, so their depths match exactly for GL_EQUAL)
+		Profiler::GPUScope gpu("depth prepass");
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		scene.draw_depth(camera->make_world_to_clip(), depth_program->program, true);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
 
-	switch (cur_phase){
-		
-		case OVER:
-			if (player2.is_winner){ winner = "Player 2";}
-			else {winner = "Player 1";}
-			render_text(winner + " wins", (windowW-300.f)/2,200.f, .5f, glm::vec3(1.f, 1.f, 1.f));
-			break; // default value
-		case DECIDING: // players are deciding on moves
+	{
+		Profiler::GPUScope gpu("scene");
+		GLSamplesScope samples;
+		if (options.depth_prepass) {
+			scene.draw(*camera, Scene::ObjectBlockDrawables);
+			//drawables the prepass skipped (no "Object" block) have no depth to match, so test them normally:
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+			scene.draw(*camera, Scene::OtherDrawables);
+		} else {
+			scene.draw(*camera);
+		}
+	}
 
-			//Render Player 1 text
-			render_text("HP: "+std::to_string(player1.cur_health), 50,225.f, .5f, glm::vec3(0, 0.8f, 0.2f));
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
 
-			if (player1.move_selected == -1) render_text("P1 make your move", 50,100.f, .5f, glm::vec3(0, 0.8f, 0.2f));
-			
-			for (int i = 0;i<player1.moves.size();i++){
+	{ //HUD:
+		Profiler::GPUScope gpu("hud");
+		DrawUI ui(*hud_atlas, glm::vec2(drawable_size));
 
-				render_text(player1.moves[i].name, 50,200.f - 30*i, .5f, glm::vec3(0, 0.8f, 0.2f));
-			}
-			
-			//Render Player 2 text
-			render_text("HP: "+std::to_string(player2.cur_health), windowW-300.f,225.f, .5f, glm::vec3(0, 0.8f, 0.2f));
+		glm::u8vec4 const text_color = glm::u8vec4(0x00, 0xcc, 0x33, 0xff);
+		float const margin = 50.0f;
 
-			if (player2.move_selected == -1) render_text("P2 make your move", windowW-300.f,100.f, .5f, glm::vec3(0, 0.8f, 0.2f));
+		//centered messages wrap to the space between the margins:
+		float const center_width = std::max(0.0f, float(drawable_size.x) - 2.0f * margin);
+		auto centered = [&](std::string const &str, float y, glm::u8vec4 const &color) {
+			ui.text(TextLayout::get(*hud_atlas, str, 0.5f, center_width, TextLayout::AlignCenter), glm::vec2(margin, y), color);
+		};
 
-			for (int i = 0;i<player2.moves.size();i++){
-				render_text(player2.moves[i].name, windowW-300.f,200.f - 30*i, .5f, glm::vec3(0, 0.8f, 0.2f));
-			}
-			
-			break;
-		case ANIMATING: // move animations are playing
-			break;
-		case REPORTING:
-			float p1_height = 200.f;
-			float p2_height = 150.f;
-			std::shared_ptr< Sound::PlayingSample >  sample2;
-			std::shared_ptr< Sound::PlayingSample >  sample1;
-			if (player1.damage_dealt > 0){
-				if (!player1.is_deciding) Sound::play_3D(*p1_hit_sample, .5f, camera->transform->position, 10.0f);
-
-				render_text("Player 1 dealt " + std::to_string(player1.damage_dealt) +" damage", (windowW-300.f)/2, p1_height, .5f, glm::vec3(0, 0.8f, 0.2f));
-			}else{
-				if (!player1.is_deciding) Sound::play_3D(*p1_miss_sample, .5f, camera->transform->position, 10.0f);
-
-				render_text("Player 1 missed", (windowW-300.f)/2, p1_height, .5f, glm::vec3(0, 0.8f, 0.2f));
+		//player 2's column sits against the right margin, so it is as wide as its widest entry:
+		float p2_width = 200.0f; //(width of health bar)
+		p2_width = std::max(p2_width, TextLayout::measure(*hud_atlas, "P2 make your move", 0.5f).x);
+		for (uint32_t i = 0; i < player2.move_count; ++i) {
+			p2_width = std::max(p2_width, TextLayout::measure(*hud_atlas, std::string(player2.moves[i].name), 0.5f).x);
+		}
+		float const right_x = float(drawable_size.x) - margin - p2_width;
+
+		//health bar with background panel underneath:
+		auto draw_health = [&](Player const &player, float health, float x, float y) {
+			float frac = glm::clamp(health / float(player.max_health), 0.0f, 1.0f);
+			ui.layer = 0;
+			ui.rect(glm::vec2(x - 2.0f, y - 2.0f), glm::vec2(x + 202.0f, y + 14.0f), glm::u8vec4(0x00, 0x00, 0x00, 0xaa));
+			ui.layer = 1;
+			ui.rect(glm::vec2(x, y), glm::vec2(x + 200.0f * frac, y + 12.0f), text_color);
+			ui.text("HP: " + std::to_string(player.cur_health), glm::vec2(x, y + 25.0f), 0.5f, text_color);
+		};
+
+		switch (cur_phase) {
+			case OVER: {
+				if (outcome == TurnResult::Draw) {
+					centered("Draw", 200.0f, glm::u8vec4(0xff));
+				} else {
+					std::string winner = (player2.is_winner ? "Player 2" : "Player 1");
+					centered(winner + " wins", 200.0f, glm::u8vec4(0xff));
+				}
+				centered("Space for a rematch", 150.0f, text_color);
+				break;
 			}
-			tick2 += elapsed;
-			while (!player1_done_speaking &&tick2 > 2.00f) {
-				tick2 -= 2.00f;
+			case DECIDING: // players are deciding on moves
+				//Player 1:
+				draw_health(player1, state.health.x, margin, 225.0f);
+				if (player1.move_selected == -1) ui.text("P1 make your move", glm::vec2(margin, 100.0f), 0.5f, text_color);
+				for (uint32_t i = 0; i < player1.move_count; ++i) {
+					ui.text(std::string(player1.moves[i].name), glm::vec2(margin, 200.0f - 30.0f * i), 0.5f, text_color);
+				}
 
+				//Player 2:
+				draw_health(player2, state.health.y, right_x, 225.0f);
+				if (player2.move_selected == -1) ui.text("P2 make your move", glm::vec2(right_x, 100.0f), 0.5f, text_color);
+				for (uint32_t i = 0; i < player2.move_count; ++i) {
+					ui.text(std::string(player2.moves[i].name), glm::vec2(right_x, 200.0f - 30.0f * i), 0.5f, text_color);
+				}
+				break;
+			case ANIMATING: // move animations are playing
+				break;
+			case REPORTING: {
+				float p1_height = 200.f;
+				float p2_height = 150.f;
+				if (player1.damage_dealt > 0){
+					centered("Player 1 dealt " + std::to_string(player1.damage_dealt) + " damage", p1_height, text_color);
+				}else{
+					centered("Player 1 missed", p1_height, text_color);
+				}
 				if (player2.damage_dealt > 0){
-					if (!player2.is_deciding) Sound::play_3D(*p2_hit_sample, .5f, camera->transform->position, 10.0f);
+					centered("Player 2 dealt " + std::to_string(player2.damage_dealt) + " damage", p2_height, text_color);
 				}else{
-					if (!player2.is_deciding) Sound::play_3D(*p2_miss_sample, .5f, camera->transform->position, 10.0f);
+					centered("Player 2 missed", p2_height, text_color);
 				}
-				player1_done_speaking= true;
-					
-					//  std::this_thread::sleep_until(std::chrono::system_clock::now() + std::chrono::seconds(1));
-				
-			
+				break;
 			}
-			if (player2.damage_dealt > 0){
-				render_text("Player 2 dealt " + std::to_string(player2.damage_dealt) +" damage", (windowW-300.f)/2, p2_height, .5f, glm::vec3(0, 0.8f, 0.2f));
-			}else{
-				render_text("Player 2 missed", (windowW-300.f)/2, p2_height, .5f, glm::vec3(0, 0.8f, 0.2f));
+		}
+
+		if (show_stats) {
+			//n.b. these are the counts for the previous frame, since this frame isn't finished yet:
+			ui.layer = 2;
+			std::vector< std::string > lines;
+			lines.emplace_back("draws: " + std::to_string(gl_stats_last_frame.draw_calls));
+			lines.emplace_back("vertices: " + std::to_string(gl_stats_last_frame.vertices));
+			lines.emplace_back("uniforms: " + std::to_string(gl_stats_last_frame.uniform_uploads));
+			lines.emplace_back("state changes: " + std::to_string(gl_stats_last_frame.state_changes));
+			lines.emplace_back("lights: " + std::to_string(clustered_lights.global_count + clustered_lights.local_count)
+				+ " (" + std::to_string(clustered_lights.index_count) + " binned)");
+			lines.emplace_back("shadow layers: " + std::to_string(shadow_maps.layers_rendered) + " / " + std::to_string(shadow_maps.layers_used) + " drawn");
+
+			//one row per line, top to bottom:
+			float const line_height = 30.0f;
+			float y = float(drawable_size.y) - 30.0f;
+			ui.rect(glm::vec2(10.0f, y - line_height * float(lines.size() - 1) - 10.0f), glm::vec2(260.0f, y + 20.0f), glm::u8vec4(0x00, 0x00, 0x00, 0xaa));
+			ui.layer = 3;
+			for (std::string const &line : lines) {
+				ui.text(line, glm::vec2(20.0f, y), 0.4f);
+				y -= line_height;
 			}
-			player1.is_deciding = true;
-			if(player1_done_speaking) player2.is_deciding = true;
-	
-			break;
+		}
 	}
-	
+
 	GL_ERRORS();
 }
@@ -1,18 +1,16 @@
 #include "Mode.hpp"
 
+#include "ClusteredLights.hpp"
 #include "Scene.hpp"
+#include "ShadowMaps.hpp"
 #include "Sound.hpp"
+#include "Battle.hpp"
 
 #include <glm/glm.hpp>
 
 #include <vector>
 #include <deque>
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
-#include "shader.hpp"
-#include <map>
 #include <string>
 
 enum Anim_Type {
@@ -35,76 +33,48 @@ enum Battle_Phase {
 	OVER // a player has won
 };
 
-struct Player;
-
-struct Move {
-	float accuracy = 1.0f;
-	std::string name = "placeholder move name";
-	virtual int activate(Player *user, Player *target) {
-		return 0;
-	};
-
-	Move(){};
-	Move(std::string name_, float acc) : accuracy(acc), name(name_) {};
-	virtual ~Move() = default;
-	// animation that should be played?
-	// sound effect that should be played?
-};
-
-struct Player {
-	// Properties shared for all players.
-	static constexpr unsigned int num_moves = 4;
-	static constexpr int max_health_default = 100;
-
-	// Methods
-	Player(unsigned int health_);
-
-	// Individual player info.
-	std::vector<Move>moves;
-	// Move *moves[num_moves];
+//a combatant plus the state the game needs to run its turns:
+struct Player : Combatant {
 	bool is_deciding = true;
 	int move_selected = -1;
 	bool is_winner = false;
-	int max_health = 100;
-	int cur_health = 100;
-	int damage_dealt = 0;
+	int damage_dealt = 0; //damage done by this player's last move (0 if it missed)
+	uint32_t pending_sound = 0; //Sound::PlayingSample::id of the chosen move's sound; choice locks in when it finishes
 	Animation active_animation;
 };
 
-struct Attack : Move {
-	static constexpr float dmg_variance_range = 0.05f; // +/- 5% of the damage
-
-	unsigned int base_damage = 10;
-	float crit_chance = 0.1f;
-	int activate(Player *user, Player *target) override;
-
-	Attack(std::string name_, unsigned int base_dmg, float acc, 
-			float crit_chance_) : base_damage(base_dmg), 
-			crit_chance(crit_chance_) {
-		Move(name_, acc);
-	};
+//rendering options (mostly for benchmarking; set from the command line):
+struct PlayOptions {
+	uint32_t extra_lights = 0; //scatter this many point lights through the scene
+	uint32_t extra_drawables = 0; //scatter this many copies of the scene's drawables around it
+	bool sun = false; //add a directional light (which casts cascaded shadows)
+	bool shadow_cache = true; //reuse shadow maps while lights and casters are still
+	bool depth_prepass = false; //draw depth first, then shade with GL_EQUAL (each pixel shaded once)
+	bool lod = true; //draw coarser levels of detail of meshes that have them when they are small on screen
 };
 
-struct Heal : Move {
-	float percent_heal = 0.5f;
-	int activate(Player *user, Player *target) override;
-};
+//time copying the game scene (with 'options' applied) by Scene::set versus Scene::Snapshot, and print the results:
+// (needs a GL context, since the scene's drawables refer to loaded meshes and programs)
+void benchmark_scene_clone(PlayOptions const &options, uint64_t seed, uint32_t trials);
 
 struct PlayMode : Mode {
-	PlayMode();
+	PlayMode(uint64_t seed, PlayOptions const &options = PlayOptions());
 	virtual ~PlayMode();
 	float tick = 0;
 	float tick2 = 0;
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
+	void handle_sound_event(Sound::Event const &evt);
 	void update_deciding(float elapsed);
 	void update_animating(float elapsed);
 	void update_reporting(float elapsed);
 	void update_over(float elapsed);
 	virtual void update(float elapsed) override;
-	virtual void draw(glm::uvec2 const &drawable_size) override;
+	virtual void draw(glm::uvec2 const &drawable_size, float alpha) override;
 	virtual void load_dialogue(std::string filename);
+	void start_battle(); //reset players, turn state, and rolls for a battle on 'seed'
+	void reset_scene_start(); //snapshot 'scene' as scene_start (and adopt its layout)
 
 	//----- game state -----
 
@@ -116,6 +86,8 @@ struct PlayMode : Mode {
 
 	//local copy of the game scene (so code can change it during gameplay):
 	Scene scene;
+	uint32_t scene_generation = 0; //game_scene reload this copy was made from
+	Scene::Snapshot scene_start; //scene as the first battle started (with options applied), restored for rematches
 	bool player1_done_speaking = false;
 	int dialogue_index = 0;
 	int windowW;
@@ -127,25 +99,28 @@ struct PlayMode : Mode {
 	//camera:
 	Scene::Camera *camera = nullptr;
 
-	struct Character {
-	    unsigned int TextureID; // ID handle of the glyph texture
-		glm::ivec2   Size;      // Size of glyph
-		glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
-		unsigned int Advance;   // Horizontal offset to advance to next glyph
-	};
-	std::map<char, Character> Characters;
-
-	glm::mat4 projection = glm::ortho(0.0f, 1280.0f, 0.0f, 720.0f);
+	//scene lights, binned for the lit program each draw, and their shadows:
+	PlayOptions options;
+	ShadowMaps shadow_maps;
+	ClusteredLights clustered_lights;
 
-	FT_Library ft;
-	FT_Face face;
-	unsigned int VAO, VBO;
-	Shader shader;
+	//simulation state that draw() interpolates between (see Mode::draw):
+	struct Snapshot {
+		glm::vec2 health = glm::vec2(0.0f); //displayed health of player 1, player 2 (eases toward cur_health)
+	};
+	Snapshot prev_snapshot; //state before the most recent update
+	Snapshot snapshot; //state after the most recent update
 
-	void render_text(std::string text, float x, float y, float scale, glm::vec3 color);
+	//show per-frame GL counters (toggled with F1):
+	bool show_stats = false;
 
 	// Battle Stuff
-	Player player1 = Player(Player::max_health_default);
-	Player player2 = Player(Player::max_health_default);
+	Player player1;
+	Player player2;
+	TurnResult::Outcome outcome = TurnResult::Ongoing;
+	//each player rolls from their own stream of the battle seed (so a seed replays a battle exactly):
+	uint64_t seed = 0;
+	Random player1_rng;
+	Random player2_rng;
 	Battle_Phase cur_phase = DECIDING;
 };
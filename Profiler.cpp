@@ -0,0 +1,197 @@
+#include "Profiler.hpp"
+
+#include "GL.hpp"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	struct Event {
+		char const *name = nullptr;
+		uint64_t begin_us = 0;
+		uint64_t end_us = 0;
+		uint32_t frame = 0;
+	};
+
+	//per-thread ring of events; only the owning thread writes:
+	struct ThreadLog {
+		static constexpr uint32_t Capacity = 1 << 16; //power of two
+		std::vector< Event > events = std::vector< Event >(Capacity);
+		std::atomic< uint64_t > written{0}; //total events ever written; next write goes to written % Capacity
+		uint32_t tid = 0;
+	};
+
+	//all thread logs ever created (never freed, so pointers stay valid for export):
+	std::mutex logs_mutex;
+	std::vector< std::unique_ptr< ThreadLog > > &get_logs() {
+		static std::vector< std::unique_ptr< ThreadLog > > logs;
+		return logs;
+	}
+
+	ThreadLog &this_thread_log() {
+		thread_local ThreadLog *log = nullptr;
+		if (!log) {
+			std::lock_guard< std::mutex > lock(logs_mutex);
+			auto &logs = get_logs();
+			logs.emplace_back(std::make_unique< ThreadLog >());
+			log = logs.back().get();
+			log->tid = uint32_t(logs.size());
+		}
+		return *log;
+	}
+
+	std::atomic< uint32_t > current_frame{0};
+
+	//--- GPU timing ---
+	//Results of queries issued in frame N are read back in frame N + FramesInFlight - 1:
+	constexpr uint32_t FramesInFlight = 4;
+
+	struct GPUQuery {
+		GLuint query = 0;
+		char const *name = nullptr;
+		uint64_t begin_us = 0; //CPU time when issued (used to place the event on the timeline)
+		uint32_t frame = 0;
+	};
+	//query objects waiting for results, one list per in-flight frame:
+	std::array< std::vector< GPUQuery >, FramesInFlight > gpu_pending;
+	//query objects ready for reuse:
+	std::vector< GLuint > gpu_free_queries;
+	//is a GL_TIME_ELAPSED query currently active?
+	bool gpu_active = false;
+
+	//finished GPU events (main thread only):
+	constexpr uint32_t GPUCapacity = 1 << 14;
+	std::vector< Event > gpu_events;
+	uint64_t gpu_written = 0;
+	uint64_t gpu_dropped = 0; //queries whose results weren't ready in time (reported by write_chrome_trace)
+}
+
+uint64_t Profiler::now_us() {
+	static auto const epoch = std::chrono::steady_clock::now();
+	return uint64_t(std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Profiler::record(char const *name, uint64_t begin_us, uint64_t end_us) {
+	ThreadLog &log = this_thread_log();
+	uint64_t index = log.written.load(std::memory_order_relaxed);
+	Event &event = log.events[index & (ThreadLog::Capacity - 1)];
+	event.name = name;
+	event.begin_us = begin_us;
+	event.end_us = end_us;
+	event.frame = current_frame.load(std::memory_order_relaxed);
+	log.written.store(index + 1, std::memory_order_release);
+}
+
+uint32_t Profiler::gpu_begin(char const *name) {
+	if (gpu_active) return -1U; //no nesting
+
+	GLuint query = 0;
+	if (!gpu_free_queries.empty()) {
+		query = gpu_free_queries.back();
+		gpu_free_queries.pop_back();
+	} else {
+		glGenQueries(1, &query);
+	}
+
+	uint32_t frame = current_frame.load(std::memory_order_relaxed);
+	auto &pending = gpu_pending[frame % FramesInFlight];
+	pending.emplace_back();
+	pending.back().query = query;
+	pending.back().name = name;
+	pending.back().begin_us = now_us();
+	pending.back().frame = frame;
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	gpu_active = true;
+
+	return uint32_t(pending.size() - 1);
+}
+
+void Profiler::gpu_end(uint32_t slot) {
+	assert(gpu_active);
+	glEndQuery(GL_TIME_ELAPSED);
+	gpu_active = false;
+	(void)slot;
+}
+
+void Profiler::end_frame() {
+	uint32_t frame = current_frame.load(std::memory_order_relaxed) + 1;
+	current_frame.store(frame, std::memory_order_relaxed);
+
+	//collect queries from the oldest in-flight frame, whose slot is about to be reused:
+	auto &pending = gpu_pending[frame % FramesInFlight];
+	for (GPUQuery const &q : pending) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(q.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsed_ns = 0;
+			glGetQueryObjectui64v(q.query, GL_QUERY_RESULT, &elapsed_ns);
+			if (gpu_events.empty()) gpu_events.resize(GPUCapacity);
+			Event &event = gpu_events[gpu_written % GPUCapacity];
+			event.name = q.name;
+			event.begin_us = q.begin_us;
+			event.end_us = q.begin_us + elapsed_ns / 1000;
+			event.frame = q.frame;
+			gpu_written += 1;
+		} else {
+			//GPU is running more than FramesInFlight behind; drop the sample rather than stall:
+			gpu_dropped += 1;
+		}
+		gpu_free_queries.emplace_back(q.query);
+	}
+	pending.clear();
+}
+
+void Profiler::write_chrome_trace(std::string const &filename) {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing profile.");
+
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	auto write_event = [&](Event const &event, uint32_t tid) {
+		if (!first) out << ",\n";
+		first = false;
+		//n.b. names are string literals from our own code, so they don't need escaping:
+		out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+		    << ",\"ts\":" << event.begin_us << ",\"dur\":" << (event.end_us - event.begin_us)
+		    << ",\"args\":{\"frame\":" << event.frame << "}}";
+	};
+
+	{ //CPU events from every thread:
+		std::lock_guard< std::mutex > lock(logs_mutex);
+		for (auto const &log : get_logs()) {
+			uint64_t written = log->written.load(std::memory_order_acquire);
+			uint64_t begin = (written > ThreadLog::Capacity ? written - ThreadLog::Capacity : 0);
+			for (uint64_t i = begin; i < written; ++i) {
+				write_event(log->events[i & (ThreadLog::Capacity - 1)], log->tid);
+			}
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << log->tid
+			    << ",\"args\":{\"name\":\"CPU " << log->tid << "\"}}";
+			first = false;
+		}
+	}
+
+	{ //GPU events on their own track:
+		constexpr uint32_t GPUTid = 0;
+		uint64_t begin = (gpu_written > GPUCapacity ? gpu_written - GPUCapacity : 0);
+		for (uint64_t i = begin; i < gpu_written; ++i) {
+			write_event(gpu_events[i % GPUCapacity], GPUTid);
+		}
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPUTid << ",\"args\":{\"name\":\"GPU\"}}";
+		first = false;
+	}
+
+	out << "\n]}\n";
+	std::cout << "Wrote profile to '" << filename << "'." << std::endl;
+	if (gpu_dropped) {
+		std::cerr << "NOTE: dropped " << gpu_dropped << " GPU timer queries whose results weren't ready within " << FramesInFlight << " frames." << std::endl;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * Lightweight frame profiler.
+ *
+ * CPU timing uses RAII scopes:
+ *
+ *   void Thing::update(float elapsed) {
+ *       PROFILE_SCOPE("Thing::update");
+ *       ...
+ *   }
+ *
+ * GPU timing uses GL_TIME_ELAPSED queries around (non-nested) passes:
+ *
+ *   { Profiler::GPUScope gpu("scene");
+ *       scene.draw(*camera);
+ *   }
+ *
+ * Query results are collected a few frames later (in end_frame()) so the CPU never waits on the GPU.
+ *
+ * Events land in fixed-size per-thread ring buffers (so the audio thread can record too, without locking);
+ * write_chrome_trace() dumps whatever is still in the rings as Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+ *
+ * When 'Profiler::enabled' is false, a scope costs one predictable branch.
+ *
+ */
+
+#include <cstdint>
+#include <string>
+
+namespace Profiler {
+	//master switch; set before call_load_functions() to also capture loading:
+	inline bool enabled = false;
+
+	//-- internals used by the inline scope classes --
+	uint64_t now_us(); //microseconds since profiler epoch
+	void record(char const *name, uint64_t begin_us, uint64_t end_us); //record a CPU event on this thread
+	uint32_t gpu_begin(char const *name); //returns query slot or -1U
+	void gpu_end(uint32_t slot);
+
+	//time a CPU scope; 'name' must be a string with static lifetime:
+	struct Scope {
+		explicit Scope(char const *name_) {
+			if (enabled) {
+				name = name_;
+				begin_us = now_us();
+			}
+		}
+		~Scope() {
+			if (name) record(name, begin_us, now_us());
+		}
+		Scope(Scope const &) = delete;
+		Scope &operator=(Scope const &) = delete;
+
+		char const *name = nullptr;
+		uint64_t begin_us = 0;
+	};
+
+	//time a GPU pass; 'name' must be a string with static lifetime:
+	// n.b. GL_TIME_ELAPSED queries can't nest, so a GPUScope inside another GPUScope is ignored.
+	struct GPUScope {
+		explicit GPUScope(char const *name) {
+			if (enabled) slot = gpu_begin(name);
+		}
+		~GPUScope() {
+			if (slot != -1U) gpu_end(slot);
+		}
+		GPUScope(GPUScope const &) = delete;
+		GPUScope &operator=(GPUScope const &) = delete;
+
+		uint32_t slot = -1U;
+	};
+
+	//call once per frame, after swapping buffers; collects finished GPU queries:
+	void end_frame();
+
+	//write all buffered events as Chrome trace JSON (and note how many GPU queries were dropped, if any):
+	// (call on the main thread once other threads have stopped recording -- e.g., after Sound::shutdown())
+	void write_chrome_trace(std::string const &filename);
+}
+
+#define PROFILE_SCOPE_CAT2(A, B) A ## B
+#define PROFILE_SCOPE_CAT(A, B) PROFILE_SCOPE_CAT2(A, B)
+#define PROFILE_SCOPE(NAME) Profiler::Scope PROFILE_SCOPE_CAT(profile_scope_, __LINE__)(NAME)
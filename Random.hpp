@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+ * Random is a small, fast generator (xoshiro256**; see https://prng.di.unimi.it/)
+ * for game rolls and simulation.
+ *
+ *  - Seeding is explicit: the same (seed, stream) always produces the same sequence (for replays).
+ *  - Different 'stream' values give independent, non-overlapping sequences from one seed
+ *    (each stream starts 2^128 draws after the previous one), so, e.g., each player or each
+ *    simulation thread can have its own generator without their rolls interacting.
+ *  - fill_floats() generates many floats at once, two per 64-bit draw.
+ *
+ * Random also satisfies UniformRandomBitGenerator, so it works with <random> distributions.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+struct Random {
+	explicit Random(uint64_t seed = 0, uint64_t stream = 0) {
+		//expand seed to full state with splitmix64 (as recommended by xoshiro's authors):
+		for (uint64_t &word : state) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			word = z ^ (z >> 31);
+		}
+		//advance to the start of this stream:
+		// (each jump costs about as much as 256 draws, so keep stream numbers small)
+		for (uint64_t i = 0; i < stream; ++i) jump();
+	}
+
+	//next 64 random bits:
+	uint64_t next() {
+		uint64_t result = rotl(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+
+	//uniform float in [0,1):
+	float next_float() {
+		return float(next() >> 40) * (1.0f / float(1 << 24));
+	}
+
+	//uniform integer in [0,n) (multiply-shift; bias is below 2^-32 * n, fine for games):
+	uint32_t below(uint32_t n) {
+		return uint32_t((uint64_t(next() >> 32) * n) >> 32);
+	}
+
+	//fill 'out' with 'count' uniform floats in [0,1):
+	void fill_floats(float *out, size_t count) {
+		size_t i = 0;
+		for (; i + 1 < count; i += 2) {
+			uint64_t bits = next();
+			out[i] = float(uint32_t(bits) >> 8) * (1.0f / float(1 << 24));
+			out[i+1] = float(uint32_t(bits >> 32) >> 8) * (1.0f / float(1 << 24));
+		}
+		if (i < count) out[i] = next_float();
+	}
+
+	//equivalent to 2^128 calls to next():
+	void jump() {
+		static constexpr uint64_t Jump[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+		uint64_t s[4] = {0, 0, 0, 0};
+		for (uint64_t word : Jump) {
+			for (uint32_t b = 0; b < 64; ++b) {
+				if (word & (uint64_t(1) << b)) {
+					for (uint32_t i = 0; i < 4; ++i) s[i] ^= state[i];
+				}
+				next();
+			}
+		}
+		for (uint32_t i = 0; i < 4; ++i) state[i] = s[i];
+	}
+
+	//UniformRandomBitGenerator interface:
+	using result_type = uint64_t;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits< result_type >::max(); }
+	result_type operator()() { return next(); }
+
+	uint64_t state[4];
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+};
@@ -1,11 +1,20 @@
 #include "Scene.hpp"
 
 #include "gl_errors.hpp"
+#include "gl_stats.hpp"
+#include "Jobs.hpp"
+#include "Profiler.hpp"
 #include "read_write_chunk.hpp"
+#include "SceneFile.hpp"
+#include "UniformBlocks.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 
 //-------------------------
 
@@ -80,83 +89,349 @@ glm::mat4 Scene::Camera::make_projection() const {
 //-------------------------
 
 
-void Scene::draw(Camera const &camera) const {
-	assert(camera.transform);
-	glm::mat4 world_to_clip = camera.make_projection() * glm::mat4(camera.transform->make_world_to_local());
+glm::mat4 Scene::Camera::make_world_to_clip() const {
+	assert(transform);
+	return make_projection() * glm::mat4(transform->make_world_to_local());
+}
+
+//-------------------------
+// Draw preparation is split in two:
+//  - a parallel phase, which works out each drawable's matrices, visibility, and sort key into flat arrays, and
+//  - a serial phase, which only issues GL calls from those arrays.
+// (transforms are only read while preparing, so workers can walk them freely)
+
+//drawables per Jobs::parallel_for chunk; smaller batches cost more to hand out than to just do:
+static constexpr uint32_t PrepareChunk = 256;
+
+//world-space planes (xyz: inward unit normal, w: offset) of the clip volume of 'world_to_clip':
+static std::array< glm::vec4, 6 > make_clip_planes(glm::mat4 const &world_to_clip) {
+	glm::mat4 rows = glm::transpose(world_to_clip);
+	std::array< glm::vec4, 6 > planes = {
+		rows[3] + rows[0], rows[3] - rows[0], //left, right
+		rows[3] + rows[1], rows[3] - rows[1], //bottom, top
+		rows[3] + rows[2], rows[3] - rows[2], //near, far
+	};
+	for (auto &plane : planes) {
+		float length = glm::length(glm::vec3(plane));
+		//(a degenerate plane -- like the far plane of an infinite projection -- never culls)
+		plane = (length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+	return planes;
+}
+
+//does a drawable's bounding sphere touch the clip volume? (drawables without bounds always do)
+static bool sphere_visible(std::array< glm::vec4, 6 > const &planes, glm::mat4x3 const &object_to_world, glm::vec4 const &sphere) {
+	if (sphere.w < 0.0f) return true;
+	glm::vec3 center = object_to_world * glm::vec4(glm::vec3(sphere), 1.0f);
+	float radius = sphere.w * std::max(glm::length(object_to_world[0]), std::max(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+	for (auto const &plane : planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+	}
+	return true;
+}
+
+//sort key that groups drawables by program, then vertex array, then first texture:
+static uint64_t state_key(Scene::Drawable::Pipeline const &pipeline) {
+	return (uint64_t(pipeline.program & 0xffff) << 48) | (uint64_t(pipeline.vao & 0xffff) << 32) | uint64_t(pipeline.textures[0].texture);
+}
+
+//order 'order' (indices into an array of keys) by key, keeping ties in scene order:
+template< typename Key >
+static void sort_by_key(std::vector< uint32_t > &order, Key const &key) {
+	auto less = [&](uint32_t a, uint32_t b) { return key(a) < key(b); };
+	if (!std::is_sorted(order.begin(), order.end(), less)) {
+		std::stable_sort(order.begin(), order.end(), less);
+	}
+}
+
+void Scene::draw(Camera const &camera, Which which) const {
+	glm::mat4 world_to_clip = camera.make_world_to_clip();
 	glm::mat4x3 world_to_light = glm::mat4x3(1.0f);
-	draw(world_to_clip, world_to_light);
+	draw(world_to_clip, world_to_light, which);
 }
 
-void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light, Which which) const {
+	PROFILE_SCOPE("Scene::draw");
+
+	//Camera and light data go to the "Frame" block once for the whole scene:
+	frame_block.WORLD_TO_CLIP = world_to_clip;
+	frame_block.WORLD_TO_LIGHT = glm::mat4(world_to_light);
+	upload_frame_block(frame_block);
 
-	//Iterate through all drawables, sending each one to OpenGL:
+	//------ gather ------
+	//skip any drawables without a shader program set, vertex array, or vertices:
+	std::vector< Drawable const * > candidates;
 	for (auto const &drawable : drawables) {
-		//Reference to drawable's pipeline for convenience:
-		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+		if (drawable.pipeline.program == 0 || drawable.pipeline.vao == 0 || drawable.pipeline.count == 0) continue;
+		if (which != AllDrawables && drawable.pipeline.object_block != (which == ObjectBlockDrawables)) continue;
+		assert(drawable.transform); //drawables *must* have a transform
+		candidates.emplace_back(&drawable);
+	}
+
+	//------ prepare (parallel) ------
+	//flat per-candidate results:
+	std::vector< glm::mat4x3 > object_to_world(candidates.size());
+	std::vector< uint64_t > keys(candidates.size());
+	std::vector< uint8_t > visible(candidates.size()); //(not vector< bool >, which packs bits and so can't be written from several threads)
+	std::array< glm::vec4, 6 > const planes = make_clip_planes(world_to_clip);
+	{
+		PROFILE_SCOPE("cull");
+		Jobs::parallel_for(uint32_t(candidates.size()), PrepareChunk, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				Drawable const &drawable = *candidates[i];
+				object_to_world[i] = drawable.transform->make_local_to_world();
+				visible[i] = sphere_visible(planes, object_to_world[i], drawable.bounding_sphere);
+				keys[i] = state_key(drawable.pipeline);
+			}
+		});
+	}
+
+	//visible candidates, grouped by state (so consecutive draws mostly share program, vertex array, and textures):
+	std::vector< uint32_t > order;
+	order.reserve(candidates.size());
+	for (uint32_t i = 0; i < uint32_t(candidates.size()); ++i) {
+		if (visible[i]) order.emplace_back(i);
+	}
+	sort_by_key(order, [&](uint32_t i) { return keys[i]; });
+
+	//each draw's matrices, in draw order: block-using programs read them from one mapped range of the "Object" ring,
+	// the rest from 'legacy' (sent as plain uniforms):
+	std::vector< uint32_t > slots(order.size()); //index into blocks or legacy
+	uint32_t block_count = 0, legacy_count = 0;
+	for (uint32_t o = 0; o < uint32_t(order.size()); ++o) {
+		slots[o] = (candidates[order[o]]->pipeline.object_block ? block_count++ : legacy_count++);
+	}
+	ObjectBlocks blocks(block_count);
+	std::vector< ObjectBlock > legacy(legacy_count);
+	{
+		PROFILE_SCOPE("matrices");
+		Jobs::parallel_for(uint32_t(order.size()), PrepareChunk, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t o = begin; o < end; ++o) {
+				uint32_t i = order[o];
+				glm::mat4 world = glm::mat4(object_to_world[i]);
+				glm::mat4 object_to_light = glm::mat4(world_to_light) * world;
+				glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
+				ObjectBlock &block = (candidates[i]->pipeline.object_block ? blocks[slots[o]] : legacy[slots[o]]);
+				block.OBJECT_TO_CLIP = world_to_clip * world;
+				block.OBJECT_TO_LIGHT = object_to_light;
+				for (uint32_t c = 0; c < 3; ++c) {
+					block.NORMAL_TO_LIGHT[c] = glm::vec4(normal_to_light[c], 0.0f);
+				}
+			}
+		});
+	}
+	blocks.unmap();
 
-		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
-		//skip any drawables that don't reference any vertex array:
-		if (pipeline.vao == 0) continue;
-		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
+	//------ submit (serial) ------
+	//state is only changed where it differs from the previous draw's:
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	Drawable::Pipeline::TextureInfo bound_textures[Drawable::Pipeline::TextureCount];
 
+	for (uint32_t o = 0; o < uint32_t(order.size()); ++o) {
+		Drawable const &drawable = *candidates[order[o]];
+		//Reference to drawable's pipeline for convenience:
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
 		//Set shader program:
-		glUseProgram(pipeline.program);
+		if (pipeline.program != bound_program) {
+			glUseProgram(pipeline.program);
+			bound_program = pipeline.program;
+			gl_stats.state_changes += 1;
+		}
 
 		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+		if (pipeline.vao != bound_vao) {
+			glBindVertexArray(pipeline.vao);
+			bound_vao = pipeline.vao;
+			gl_stats.state_changes += 1;
+		}
 
 		//Configure program uniforms:
+		if (pipeline.object_block) {
+			//already written above; just point the "Object" block at this drawable's slice:
+			blocks.bind(slots[o]);
+		} else {
+			ObjectBlock const &block = legacy[slots[o]];
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+			//OBJECT_TO_CLIP takes vertices from object space to clip space:
+			if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
+				glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(block.OBJECT_TO_CLIP));
+				gl_stats.uniform_uploads += 1;
+			}
 
-		//OBJECT_TO_CLIP takes vertices from object space to clip space:
-		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
-			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
+			//OBJECT_TO_LIGHT takes vertices from object space to light space:
+			if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
+				glm::mat4x3 object_to_light = glm::mat4x3(block.OBJECT_TO_LIGHT);
+				glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+				gl_stats.uniform_uploads += 1;
+			}
+
+			//NORMAL_TO_LIGHT takes normals from object space to light space:
+			if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
+				glm::mat3 normal_to_light = glm::mat3(glm::vec3(block.NORMAL_TO_LIGHT[0]), glm::vec3(block.NORMAL_TO_LIGHT[1]), glm::vec3(block.NORMAL_TO_LIGHT[2]));
+				glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+				gl_stats.uniform_uploads += 1;
+			}
 		}
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+		//set any requested custom uniforms:
+		if (pipeline.set_uniforms) pipeline.set_uniforms();
 
-		//OBJECT_TO_CLIP takes vertices from object space to light space:
-		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+		//set up textures (including un-binding any the previous draw used but this one doesn't):
+		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+			Drawable::Pipeline::TextureInfo const &want = pipeline.textures[i];
+			Drawable::Pipeline::TextureInfo &have = bound_textures[i];
+			if (want.texture == have.texture && (want.texture == 0 || want.target == have.target)) continue;
+			glActiveTexture(GL_TEXTURE0 + i);
+			if (have.texture != 0 && (want.texture == 0 || want.target != have.target)) glBindTexture(have.target, 0);
+			if (want.texture != 0) glBindTexture(want.target, want.texture);
+			have = want;
+			gl_stats.state_changes += 1;
 		}
 
-		//NORMAL_TO_CLIP takes normals from object space to light space:
-		if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
-			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
-			glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+		//draw the object (at its selected level of detail):
+		GLuint start = pipeline.start, count = pipeline.count;
+		if (drawable.lod != 0) {
+			start = drawable.lods[drawable.lod - 1].start;
+			count = drawable.lods[drawable.lod - 1].count;
 		}
+		glDrawArrays(pipeline.type, start, count);
+		gl_stats.draw_calls += 1;
+		gl_stats.vertices += count;
+	}
 
-		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+	//un-bind textures:
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (bound_textures[i].texture != 0) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(bound_textures[i].target, 0);
+			gl_stats.state_changes += 1;
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
 
-		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+	glUseProgram(0);
+	glBindVertexArray(0);
+
+	GL_ERRORS();
+	//(blocks' destructor fences the ring range now that all draws reading it are issued)
+}
+
+void Scene::update_lods(glm::mat4 const &world_to_clip, float viewport_height, float pixel_error, float hysteresis) {
+	PROFILE_SCOPE("Scene::update_lods");
+
+	//pixels per world unit at clip w == 1 (the length of the projection's y row, which survives the view rotation):
+	float const pixels_per_unit = 0.5f * viewport_height * glm::length(glm::vec3(world_to_clip[0][1], world_to_clip[1][1], world_to_clip[2][1]));
+
+	std::vector< Drawable * > candidates;
+	for (auto &drawable : drawables) {
+		if (drawable.lod_count == 0) {
+			drawable.lod = 0;
+			continue;
+		}
+		assert(drawable.transform); //drawables *must* have a transform
+		candidates.emplace_back(&drawable);
+	}
+
+	Jobs::parallel_for(uint32_t(candidates.size()), PrepareChunk, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Drawable &drawable = *candidates[i];
+			glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+
+			//projected size of one object-space unit at the bounding sphere's center:
+			// (largest axis scale, so non-uniformly scaled objects err toward detail)
+			float w = (world_to_clip * glm::vec4(object_to_world * glm::vec4(glm::vec3(drawable.bounding_sphere), 1.0f), 1.0f)).w;
+			float scale = std::max(glm::length(object_to_world[0]), std::max(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+			if (!(w > 0.0f)) {
+				//center at (or behind) the eye -- full detail:
+				drawable.lod = 0;
+				continue;
 			}
+			float pixels = scale * pixels_per_unit / w;
+			auto error_pixels = [&](uint32_t level) {
+				return (level == 0 ? 0.0f : drawable.lods[level - 1].error * pixels);
+			};
+
+			uint32_t level = std::min(drawable.lod, drawable.lod_count);
+			//refine while the current level is clearly too coarse:
+			while (level > 0 && error_pixels(level) > pixel_error * (1.0f + hysteresis)) --level;
+			//coarsen while the next level is clearly fine:
+			while (level < drawable.lod_count && error_pixels(level + 1) < pixel_error * (1.0f - hysteresis)) ++level;
+			drawable.lod = level;
 		}
+	});
+}
 
-		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+void Scene::draw_depth(glm::mat4 const &world_to_clip, GLuint program, bool front_to_back) const {
+	PROFILE_SCOPE("Scene::draw_depth");
 
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
-			}
+	//gather drawables that use the "Object" block:
+	std::vector< Drawable const * > candidates;
+	for (auto const &drawable : drawables) {
+		if (!(drawable.pipeline.object_block && drawable.pipeline.vao != 0 && drawable.pipeline.count != 0)) continue;
+		assert(drawable.transform); //drawables *must* have a transform
+		candidates.emplace_back(&drawable);
+	}
+
+	//object-to-clip matrices, visibility, and depth (clip-space z of bounding sphere center, which increases away from the viewer):
+	std::vector< glm::mat4 > object_to_clip(candidates.size());
+	std::vector< float > depths(candidates.size());
+	std::vector< uint8_t > visible(candidates.size());
+	std::array< glm::vec4, 6 > const planes = make_clip_planes(world_to_clip);
+	Jobs::parallel_for(uint32_t(candidates.size()), PrepareChunk, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Drawable const &drawable = *candidates[i];
+			glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+			visible[i] = sphere_visible(planes, object_to_world, drawable.bounding_sphere);
+			object_to_clip[i] = world_to_clip * glm::mat4(object_to_world);
+			depths[i] = (object_to_clip[i] * glm::vec4(glm::vec3(drawable.bounding_sphere), 1.0f)).z;
 		}
-		glActiveTexture(GL_TEXTURE0);
+	});
 
+	std::vector< uint32_t > order;
+	order.reserve(candidates.size());
+	for (uint32_t i = 0; i < uint32_t(candidates.size()); ++i) {
+		if (visible[i]) order.emplace_back(i);
+	}
+	if (front_to_back) {
+		//nearest first, so later draws are rejected by early depth testing:
+		sort_by_key(order, [&](uint32_t i) { return depths[i]; });
+	}
+
+	ObjectBlocks blocks(uint32_t(order.size()));
+	Jobs::parallel_for(uint32_t(order.size()), PrepareChunk, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t o = begin; o < end; ++o) {
+			//(only OBJECT_TO_CLIP is read by depth programs)
+			blocks[o].OBJECT_TO_CLIP = object_to_clip[order[o]];
+		}
+	});
+	blocks.unmap();
+
+	glUseProgram(program);
+	gl_stats.state_changes += 1;
+
+	GLuint bound_vao = 0;
+	for (uint32_t o = 0; o < uint32_t(order.size()); ++o) {
+		Drawable const &drawable = *candidates[order[o]];
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+
+		//drawables mostly share a vertex array, so only re-bind on change:
+		if (pipeline.vao != bound_vao) {
+			glBindVertexArray(pipeline.vao);
+			bound_vao = pipeline.vao;
+			gl_stats.state_changes += 1;
+		}
+		blocks.bind(o);
+
+		GLuint start = pipeline.start, count = pipeline.count;
+		if (drawable.lod != 0) {
+			start = drawable.lods[drawable.lod - 1].start;
+			count = drawable.lods[drawable.lod - 1].count;
+		}
+		glDrawArrays(pipeline.type, start, count);
+		gl_stats.draw_calls += 1;
+		gl_stats.vertices += count;
 	}
 
 	glUseProgram(0);
@@ -166,13 +441,140 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 }
 
 
+//-------------------------
+//name index:
+
+static Scene::NameID find_in(Scene::NameIndex const &index, std::string_view name, uint64_t hash) {
+	auto range = index.ids.equal_range(hash);
+	for (auto f = range.first; f != range.second; ++f) {
+		if (index.names[f->second] == name) return f->second;
+	}
+	return -1U;
+}
+
+static Scene::NameID intern_in(Scene::NameIndex &index, std::string_view name, uint64_t hash) {
+	Scene::NameID id = find_in(index, name, hash);
+	if (id == -1U) {
+		id = Scene::NameID(index.names.size());
+		index.names.emplace_back(name);
+		index.ids.emplace(hash, id);
+	}
+	return id;
+}
+
+//list 'transform' under 'id' (which it is named):
+static void add_to(Scene::NameIndex &index, Scene::Transform *transform, Scene::NameID id) {
+	if (index.transforms.size() < index.names.size()) index.transforms.resize(index.names.size());
+	transform->name_id = id;
+	index.transforms[id].emplace_back(transform);
+}
+
+Scene::NameID Scene::intern(std::string_view name) {
+	return intern_in(name_index, name, hash_name(name));
+}
+
+Scene::NameID Scene::find_name(std::string_view name) const {
+	return find_in(name_index, name, hash_name(name));
+}
+
+std::string const &Scene::name_text(NameID id) const {
+	if (id >= name_index.names.size()) {
+		throw std::runtime_error("Name id " + std::to_string(id) + " was not interned in this scene.");
+	}
+	return name_index.names[id];
+}
+
+std::vector< Scene::Transform * > const &Scene::find_all(NameID id) const {
+	static std::vector< Transform * > const none;
+	if (id >= name_index.transforms.size()) return none;
+	return name_index.transforms[id];
+}
+
+std::vector< Scene::Transform * > const &Scene::find_all(std::string_view name) const {
+	return find_all(find_name(name));
+}
+
+Scene::Transform *Scene::find(NameID id) {
+	std::vector< Transform * > const &all = find_all(id);
+	return (all.empty() ? nullptr : all[0]);
+}
+
+Scene::Transform const *Scene::find(NameID id) const {
+	std::vector< Transform * > const &all = find_all(id);
+	return (all.empty() ? nullptr : all[0]);
+}
+
+Scene::Transform *Scene::find(std::string_view name) {
+	return find(find_name(name));
+}
+
+Scene::Transform const *Scene::find(std::string_view name) const {
+	return find(find_name(name));
+}
+
+void Scene::index(Transform *transform) {
+	add_to(name_index, transform, intern(transform->name));
+}
+
+void Scene::reindex() {
+	for (auto &list : name_index.transforms) {
+		list.clear();
+	}
+	for (auto &t : transforms) {
+		index(&t);
+	}
+}
+
+//-------------------------
+
+//cameras and lights are stored the same way in both scene file versions:
+static void load_camera(Scene &scene, SceneFile::CameraEntry const &c, Scene::Transform *transform) {
+	if (std::string(c.type, 4) != "pers") {
+		std::cout << "Ignoring non-perspective camera (" + std::string(c.type, 4) + ") stored in file." << std::endl;
+		return;
+	}
+	scene.cameras.emplace_back(transform);
+	Scene::Camera *camera = &scene.cameras.back();
+	camera->fovy = c.data / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
+	camera->near = c.clip_near;
+	//N.b. far plane is ignored because cameras use infinite perspective matrices.
+}
+
+static void load_light(Scene &scene, SceneFile::LightEntry const &l, Scene::Transform *transform) {
+	if (l.type == 'p') {
+		//good
+	} else if (l.type == 'h') {
+		//fine
+	} else if (l.type == 's') {
+		//okay
+	} else if (l.type == 'd') {
+		//sure
+	} else {
+		std::cout << "Ignoring unrecognized lamp type (" + std::string(&l.type, 1) + ") stored in file." << std::endl;
+		return;
+	}
+	scene.lights.emplace_back(transform);
+	Scene::Light *light = &scene.lights.back();
+	light->type = static_cast<Scene::Light::Type>(l.type);
+	light->energy = glm::vec3(l.color[0], l.color[1], l.color[2]) / 255.0f * l.energy;
+	light->distance = l.distance;
+	light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
+}
+
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	if (SceneFile::is_v2(filename)) {
+		load(SceneFile(filename), on_drawable);
+		return;
+	}
+
+	//(version 1 chunks aren't necessarily aligned where they sit, so they are copied out)
+	MappedFile file(filename);
+	ChunkReader chunks(file);
 
 	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	chunks.read(chunks.get("str0"), &names);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -184,7 +586,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
 	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	chunks.read(chunks.get("xfh0"), &hierarchy);
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -193,29 +595,14 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
 	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	chunks.read(chunks.get("msh0"), &meshes);
 
-	struct CameraEntry {
-		uint32_t transform;
-		char type[4]; //"pers" or "orth"
-		float data; //fov in degrees for 'pers', scale for 'orth'
-		float clip_near, clip_far;
-	};
-	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
-	std::vector< CameraEntry > loaded_cameras;
-	read_chunk(file, "cam0", &loaded_cameras);
+	std::vector< SceneFile::CameraEntry > loaded_cameras;
+	chunks.read(chunks.get("cam0"), &loaded_cameras);
 
-	struct LightEntry {
-		uint32_t transform;
-		char type;
-		glm::u8vec3 color;
-		float energy;
-		float distance;
-		float fov;
-	};
-	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
-	std::vector< LightEntry > loaded_lights;
-	read_chunk(file, "lmp0", &loaded_lights);
+	ChunkReader::Chunk const &lmp0 = chunks.get("lmp0");
+	std::vector< SceneFile::LightEntry > loaded_lights;
+	chunks.read(lmp0, &loaded_lights);
 
 
 	//--------------------------------
@@ -245,6 +632,7 @@ void Scene::load(std::string const &filename,
 		t->scale = h.scale;
 
 		hierarchy_transforms.emplace_back(t);
+		index(t);
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
 
@@ -267,44 +655,21 @@ void Scene::load(std::string const &filename,
 		if (c.transform >= hierarchy_transforms.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains camera entry with invalid transform index (" + std::to_string(c.transform) + ")");
 		}
-		if (std::string(c.type, 4) != "pers") {
-			std::cout << "Ignoring non-perspective camera (" + std::string(c.type, 4) + ") stored in file." << std::endl;
-			continue;
-		}
-		cameras.emplace_back(hierarchy_transforms[c.transform]);
-		Camera *camera = &cameras.back();
-		camera->fovy = c.data / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
-		camera->near = c.clip_near;
-		//N.b. far plane is ignored because cameras use infinite perspective matrices.
+		load_camera(*this, c, hierarchy_transforms[c.transform]);
 	}
 
 	for (auto const &l : loaded_lights) {
 		if (l.transform >= hierarchy_transforms.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains lamp entry with invalid transform index (" + std::to_string(l.transform) + ")");
 		}
-		if (l.type == 'p') {
-			//good
-		} else if (l.type == 'h') {
-			//fine
-		} else if (l.type == 's') {
-			//okay
-		} else if (l.type == 'd') {
-			//sure
-		} else {
-			std::cout << "Ignoring unrecognized lamp type (" + std::string(&l.type, 1) + ") stored in file." << std::endl;
-			continue;
-		}
-		lights.emplace_back(hierarchy_transforms[l.transform]);
-		Light *light = &lights.back();
-		light->type = static_cast<Light::Type>(l.type);
-		light->energy = glm::vec3(l.color) / 255.0f * l.energy;
-		light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
+		load_light(*this, l, hierarchy_transforms[l.transform]);
 	}
 
-	//load any extra that a subclass wants:
-	load_extra(file, names, hierarchy_transforms);
+	//load any extra that a subclass wants (from the chunks after lmp0):
+	std::istringstream extra(std::string(lmp0.data + lmp0.size, std::max(lmp0.data + lmp0.size, chunks.end)));
+	load_extra(extra, names, hierarchy_transforms);
 
-	if (file.peek() != EOF) {
+	if (extra.peek() != EOF) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -312,6 +677,67 @@ void Scene::load(std::string const &filename,
 
 }
 
+void Scene::load(SceneFile const &file,
+	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+	//(SceneFile checked every index on opening, so entries are used without further checks)
+
+	static_assert(sizeof(glm::vec3) == sizeof(SceneFile::TransformEntry::position), "position stored as glm::vec3");
+	static_assert(sizeof(glm::quat) == sizeof(SceneFile::TransformEntry::rotation), "rotation stored as glm::quat");
+	static_assert(sizeof(glm::vec3) == sizeof(SceneFile::TransformEntry::scale), "scale stored as glm::vec3");
+
+	//each of the file's names is interned once, with the hash stored in the file:
+	std::vector< NameID > name_ids(file.name_count, -1U);
+
+	std::vector< Transform * > hierarchy_transforms(file.transform_count);
+	for (size_t i = 0; i < file.transform_count; ++i) {
+		SceneFile::TransformEntry const &entry = file.transforms[i];
+		transforms.emplace_back();
+		Transform *t = &transforms.back();
+		if (entry.parent != -1U) t->parent = hierarchy_transforms[entry.parent]; //(parents always come first)
+		t->name = file.name(entry.name);
+		if (name_ids[entry.name] == -1U) {
+			name_ids[entry.name] = intern_in(name_index, t->name, file.names[entry.name].hash);
+		}
+		add_to(name_index, t, name_ids[entry.name]);
+		std::memcpy(&t->position, entry.position, sizeof(entry.position));
+		std::memcpy(&t->rotation, entry.rotation, sizeof(entry.rotation));
+		std::memcpy(&t->scale, entry.scale, sizeof(entry.scale));
+		hierarchy_transforms[i] = t;
+	}
+
+	if (on_drawable) {
+		//each distinct mesh name is made into a string once, however many drawables use it:
+		std::vector< std::string > mesh_names(file.name_count);
+		std::vector< bool > made(file.name_count, false);
+		for (size_t i = 0; i < file.mesh_count; ++i) {
+			SceneFile::MeshEntry const &entry = file.meshes[i];
+			if (!made[entry.name]) {
+				mesh_names[entry.name] = file.name(entry.name);
+				made[entry.name] = true;
+			}
+			on_drawable(*this, hierarchy_transforms[entry.transform], mesh_names[entry.name]);
+		}
+	}
+
+	for (size_t i = 0; i < file.camera_count; ++i) {
+		load_camera(*this, file.cameras[i], hierarchy_transforms[file.cameras[i].transform]);
+	}
+
+	for (size_t i = 0; i < file.light_count; ++i) {
+		load_light(*this, file.lights[i], hierarchy_transforms[file.lights[i].transform]);
+	}
+
+	//load any extra that a subclass wants:
+	// (load_extra reads from a stream, so this is the one place data is copied)
+	std::vector< char > names(file.strings, file.strings + file.string_count);
+	std::istringstream extra(std::string(file.extra, file.extra_end));
+	load_extra(extra, names, hierarchy_transforms);
+
+	if (extra.peek() != EOF) {
+		std::cerr << "WARNING: trailing data in scene file '" << file.file.filename << "'" << std::endl;
+	}
+}
+
 //-------------------------
 
 Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
@@ -342,6 +768,7 @@ void Scene::set(Scene const &other, std::unordered_map< Transform const *, Trans
 	for (auto const &t : other.transforms) {
 		transforms.emplace_back();
 		transforms.back().name = t.name;
+		transforms.back().name_id = t.name_id;
 		transforms.back().position = t.position;
 		transforms.back().rotation = t.rotation;
 		transforms.back().scale = t.scale;
@@ -374,4 +801,175 @@ void Scene::set(Scene const &other, std::unordered_map< Transform const *, Trans
 	for (auto &l : lights) {
 		l.transform = transform_to_transform.at(l.transform);
 	}
+
+	//copy other's name index, updating transform pointers:
+	name_index.names = other.name_index.names;
+	name_index.ids = other.name_index.ids;
+	name_index.transforms.assign(other.name_index.transforms.size(), std::vector< Transform * >());
+	for (size_t id = 0; id < other.name_index.transforms.size(); ++id) {
+		name_index.transforms[id].reserve(other.name_index.transforms[id].size());
+		for (Transform *t : other.name_index.transforms[id]) {
+			name_index.transforms[id].emplace_back(transform_to_transform.at(t));
+		}
+	}
+
+	//(same structure, so the same layout -- if it has one)
+	layout = other.layout;
+}
+
+Scene::Snapshot Scene::snapshot() const {
+	Snapshot ret;
+	auto layout_ = std::make_shared< Snapshot::Layout >();
+
+	//transform -> index, by binary search in a sorted array (one allocation, unlike a hash map):
+	std::vector< std::pair< Transform const *, uint32_t > > index_of;
+	index_of.reserve(transforms.size());
+	for (auto const &t : transforms) {
+		index_of.emplace_back(&t, uint32_t(index_of.size()));
+	}
+	std::sort(index_of.begin(), index_of.end());
+	auto lookup = [&index_of](Transform const *t) -> uint32_t {
+		if (t == nullptr) return -1U;
+		auto f = std::lower_bound(index_of.begin(), index_of.end(), std::make_pair(t, 0U));
+		if (f == index_of.end() || f->first != t) {
+			throw std::runtime_error("Scene refers to a transform that isn't in its transforms list.");
+		}
+		return f->second;
+	};
+
+	//names (transforms that aren't in the index yet are interned in the layout's copy):
+	layout_->names.names = name_index.names;
+	layout_->names.ids = name_index.ids;
+	layout_->name_ids.reserve(transforms.size());
+	for (auto const &t : transforms) {
+		NameID id = t.name_id;
+		if (id >= layout_->names.names.size() || layout_->names.names[id] != t.name) {
+			id = intern_in(layout_->names, t.name, hash_name(t.name));
+		}
+		layout_->name_ids.emplace_back(id);
+	}
+
+	layout_->parents.reserve(transforms.size());
+	ret.transforms.reserve(transforms.size());
+	for (auto const &t : transforms) {
+		layout_->parents.emplace_back(lookup(t.parent));
+		ret.transforms.emplace_back(Snapshot::TransformState{t.position, t.rotation, t.scale});
+	}
+
+	layout_->drawables.reserve(drawables.size());
+	ret.drawable_lods.reserve(drawables.size());
+	for (auto const &d : drawables) {
+		layout_->drawables.emplace_back();
+		Snapshot::DrawableShape &shape = layout_->drawables.back();
+		shape.transform = lookup(d.transform);
+		shape.bounding_sphere = d.bounding_sphere;
+		shape.lod_count = d.lod_count;
+		std::copy(d.lods, d.lods + Drawable::MaxLODs, shape.lods);
+		shape.pipeline = d.pipeline;
+		ret.drawable_lods.emplace_back(d.lod);
+	}
+
+	for (auto const &c : cameras) {
+		layout_->camera_transforms.emplace_back(lookup(c.transform));
+		ret.cameras.emplace_back(Snapshot::CameraState{c.fovy, c.aspect, c.near});
+	}
+
+	for (auto const &l : lights) {
+		layout_->light_transforms.emplace_back(lookup(l.transform));
+		ret.lights.emplace_back(Snapshot::LightState{l.type, l.energy, l.distance, l.spot_fov});
+	}
+
+	ret.layout = layout_;
+	return ret;
+}
+
+void Scene::restore(Snapshot const &snapshot) {
+	if (!snapshot.layout) throw std::runtime_error("Restoring a scene from an empty snapshot.");
+	Snapshot::Layout const &from = *snapshot.layout;
+
+	bool in_place = (layout == snapshot.layout
+		&& transforms.size() == from.name_ids.size()
+		&& drawables.size() == from.drawables.size()
+		&& cameras.size() == from.camera_transforms.size()
+		&& lights.size() == from.light_transforms.size()
+	);
+
+	//transforms by index:
+	std::vector< Transform * > nodes;
+	nodes.reserve(from.name_ids.size());
+	if (in_place) {
+		for (auto &t : transforms) nodes.emplace_back(&t);
+	} else {
+		transforms.clear();
+		drawables.clear();
+		cameras.clear();
+		lights.clear();
+
+		//(every transform is indexed, under the layout's ids)
+		name_index.names = from.names.names;
+		name_index.ids = from.names.ids;
+		name_index.transforms.assign(name_index.names.size(), std::vector< Transform * >());
+		for (NameID id : from.name_ids) {
+			transforms.emplace_back();
+			transforms.back().name = name_index.names[id];
+			add_to(name_index, &transforms.back(), id);
+			nodes.emplace_back(&transforms.back());
+		}
+		for (auto const &shape : from.drawables) {
+			drawables.emplace_back(nodes[shape.transform]);
+			Drawable &d = drawables.back();
+			d.bounding_sphere = shape.bounding_sphere;
+			d.lod_count = shape.lod_count;
+			std::copy(shape.lods, shape.lods + Drawable::MaxLODs, d.lods);
+			d.pipeline = shape.pipeline;
+		}
+		for (uint32_t t : from.camera_transforms) cameras.emplace_back(nodes[t]);
+		for (uint32_t t : from.light_transforms) lights.emplace_back(nodes[t]);
+
+		layout = snapshot.layout;
+	}
+
+	//per-instance state (and hierarchy, in case gameplay re-parented things):
+	{
+		uint32_t i = 0;
+		for (auto &t : transforms) {
+			Snapshot::TransformState const &state = snapshot.transforms[i];
+			t.position = state.position;
+			t.rotation = state.rotation;
+			t.scale = state.scale;
+			t.parent = (from.parents[i] == -1U ? nullptr : nodes[from.parents[i]]);
+			++i;
+		}
+	}
+	{
+		uint32_t i = 0;
+		for (auto &d : drawables) {
+			d.transform = nodes[from.drawables[i].transform];
+			d.lod = snapshot.drawable_lods[i];
+			++i;
+		}
+	}
+	{
+		uint32_t i = 0;
+		for (auto &c : cameras) {
+			Snapshot::CameraState const &state = snapshot.cameras[i];
+			c.transform = nodes[from.camera_transforms[i]];
+			c.fovy = state.fovy;
+			c.aspect = state.aspect;
+			c.near = state.near;
+			++i;
+		}
+	}
+	{
+		uint32_t i = 0;
+		for (auto &l : lights) {
+			Snapshot::LightState const &state = snapshot.lights[i];
+			l.transform = nodes[from.light_transforms[i]];
+			l.type = state.type;
+			l.energy = state.energy;
+			l.distance = state.distance;
+			l.spot_fov = state.spot_fov;
+			++i;
+		}
+	}
 }
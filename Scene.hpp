@@ -19,13 +19,20 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
+struct SceneFile;
+
 struct Scene {
+	//Transform names are interned per scene: each distinct name gets a small integer id (see "name index" below):
+	typedef uint32_t NameID;
+
 	struct Transform {
 		//Transform names are useful for debugging and looking up locations in a loaded scene:
 		std::string name;
+		NameID name_id = -1U; //set when the transform is added to the scene's name index (-1U if it hasn't been)
 
 		//The core function of a transform is to store a transformation in the world:
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -54,6 +61,21 @@ struct Scene {
 		Drawable(Transform *transform_) : transform(transform_) { assert(transform); }
 		Transform * transform;
 
+		//Object-space bounding sphere (center, radius) -- for ordering and culling; leave radius negative if unknown:
+		glm::vec4 bounding_sphere = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+
+		//Coarser vertex ranges (finest first) to draw in place of pipeline.start/count when small on screen:
+		// (copy these from Mesh::lods; selected by Scene::update_lods)
+		enum : uint32_t { MaxLODs = 4 };
+		struct LOD {
+			GLuint start = 0;
+			GLuint count = 0;
+			float error = 0.0f; //object-space distance this level may stray from the full-detail surface
+		};
+		uint32_t lod_count = 0;
+		LOD lods[MaxLODs];
+		uint32_t lod = 0; //level to draw: 0 is full detail, otherwise lods[lod-1]
+
 		//Contains all the data needed to run the OpenGL pipeline:
 		struct Pipeline {
 			GLuint program = 0; //shader program; passed to glUseProgram
@@ -69,6 +91,7 @@ struct Scene {
 			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
 			GLuint OBJECT_TO_LIGHT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
 			GLuint NORMAL_TO_LIGHT_mat3 = -1U; //uniform location for normal to light space (== world space) matrix
+			bool object_block = false; //program reads the above from the "Object" uniform block (see UniformBlocks.hpp) instead
 
 			std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
 
@@ -93,6 +116,8 @@ struct Scene {
 		float near = 0.01f; //near plane
 		//computed from the above:
 		glm::mat4 make_projection() const;
+		//..and also the transform:
+		glm::mat4 make_world_to_clip() const;
 	};
 
 	struct Light {
@@ -112,6 +137,9 @@ struct Scene {
 		//  (i.e., "red, gree, blue" light color)
 		glm::vec3 energy = glm::vec3(1.0f);
 
+		//Point/spot light reach (lights have no effect past this; 0 = no limit):
+		float distance = 0.0f;
+
 		//Spotlight specific:
 		float spot_fov = glm::radians(45.0f); //spot cone fov (in radians)
 	};
@@ -123,20 +151,45 @@ struct Scene {
 	std::list< Light > lights;
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
-	void draw(Camera const &camera) const;
+	// drawables whose bounding spheres are outside the view are skipped, and the rest are drawn grouped
+	// by program, vertex array, and first texture (in scene order within a group), re-binding only what changes.
+	// (so set_uniforms functions shouldn't leave other programs, vertex arrays, or textures bound)
+	// 'which' can limit the draw to drawables that do (or don't) use the "Object" block -- e.g., to shade
+	// with GL_EQUAL after draw_depth(), which only lays down depth for drawables that use it.
+	enum Which : uint8_t { AllDrawables, ObjectBlockDrawables, OtherDrawables };
+	void draw(Camera const &camera, Which which = AllDrawables) const;
 
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
-	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
+	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f), Which which = AllDrawables) const;
+
+	//Pick each drawable's level of detail for a view: the coarsest level whose error projects to at most
+	// 'pixel_error' pixels (given the viewport height). To avoid flickering between levels at the
+	// threshold, a drawable only switches once a level is past it by the 'hysteresis' fraction.
+	// (call once per frame, before any draws -- so depth and shading passes draw the same levels)
+	void update_lods(glm::mat4 const &world_to_clip, float viewport_height, float pixel_error = 1.0f, float hysteresis = 0.25f);
+
+	//..or draw only depth, with a program that reads the "Object" block and Position at location 0 (see DepthProgram.hpp):
+	// (draws only drawables whose pipelines use the "Object" block, without their textures or set_uniforms)
+	// front_to_back sorts by bounding sphere center, so occluded surfaces fail depth testing early
+	// (drawables outside world_to_clip's volume are skipped, as in draw()):
+	void draw_depth(glm::mat4 const &world_to_clip, GLuint program, bool front_to_back = false) const;
 
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
+	// reads version 1 files (from export-scene.py) and version 2 files (from convert-scene; see SceneFile.hpp)
 	// throws on file format errors
 	void load(std::string const &filename,
 		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
 	);
 
+	//..or from an already-mapped version 2 file:
+	void load(SceneFile const &file,
+		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+	);
+
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
+	// (the file's transforms are already in the name index, so find() works here)
 	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) { }
 
 	//empty scene:
@@ -150,4 +203,91 @@ struct Scene {
 	Scene &operator=(Scene const &); //...as scene = scene
 	//... as a set() function that optionally returns the transform->transform mapping:
 	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+
+	//Name index -- find transforms by name in (expected) constant time:
+	// load(), set(), and restore() keep it up to date; transforms you add yourself are only found once passed to index(),
+	// and after renaming or removing indexed transforms, call reindex().
+	// Several transforms may share a name; they are listed in the order they were indexed (for a loaded scene, file order).
+	// Ids are never reused or dropped, and copies of a scene (set() or snapshot()/restore()) use the same ids.
+
+	//id of a name, adding it if it's new:
+	NameID intern(std::string_view name);
+	//id of a name, or -1U if it hasn't been interned:
+	NameID find_name(std::string_view name) const;
+	//text of an interned name:
+	std::string const &name_text(NameID id) const;
+
+	//first transform with a name (or nullptr if there are none):
+	Transform *find(std::string_view name);
+	Transform const *find(std::string_view name) const;
+	Transform *find(NameID id);
+	Transform const *find(NameID id) const;
+	//every transform with a name (empty if there are none):
+	std::vector< Transform * > const &find_all(std::string_view name) const;
+	std::vector< Transform * > const &find_all(NameID id) const;
+
+	//add a transform (already in 'transforms') to the index under its current name:
+	void index(Transform *transform);
+	//rebuild the index from 'transforms' (keeping existing ids):
+	void reindex();
+
+	struct NameIndex {
+		std::vector< std::string > names; //by id
+		std::unordered_multimap< uint64_t, NameID > ids; //hash_name() of name -> id
+		std::vector< std::vector< Transform * > > transforms; //by id
+	} name_index;
+
+	//A 'Snapshot' is a flat, pointer-free copy of a scene, for making (and re-making) many instances of it cheaply:
+	// structure -- names, hierarchy, and everything about drawables but their transforms and current level of detail --
+	// is kept in a 'Layout' shared (read-only) by the snapshot, its copies, and every scene restored from them;
+	// the per-instance state that gameplay changes is kept in plain arrays, in the order of the scene's lists.
+	struct Snapshot {
+		struct DrawableShape {
+			uint32_t transform = -1U; //index into transforms
+			glm::vec4 bounding_sphere;
+			uint32_t lod_count = 0;
+			Drawable::LOD lods[Drawable::MaxLODs];
+			Drawable::Pipeline pipeline;
+		};
+		struct Layout {
+			NameIndex names; //interned names (without 'transforms')
+			std::vector< NameID > name_ids; //per transform
+			std::vector< uint32_t > parents; //per transform: index of parent, or -1U
+			std::vector< DrawableShape > drawables;
+			std::vector< uint32_t > camera_transforms;
+			std::vector< uint32_t > light_transforms;
+		};
+		std::shared_ptr< Layout const > layout;
+
+		struct TransformState {
+			glm::vec3 position;
+			glm::quat rotation;
+			glm::vec3 scale;
+		};
+		struct CameraState {
+			float fovy, aspect, near;
+		};
+		struct LightState {
+			Light::Type type;
+			glm::vec3 energy;
+			float distance, spot_fov;
+		};
+		std::vector< TransformState > transforms;
+		std::vector< uint32_t > drawable_lods;
+		std::vector< CameraState > cameras;
+		std::vector< LightState > lights;
+	};
+
+	//flatten this scene into a snapshot (with a new layout):
+	Snapshot snapshot() const;
+
+	//make this scene a copy of a snapshot:
+	// if this scene was last restored from a snapshot with the same layout and still has as many of each object,
+	// only per-instance state, parents, and transform pointers are written (in place, nothing allocated per object);
+	// otherwise the lists are rebuilt from the layout (parents fixed up by index, so no pointer map is needed).
+	// (names, pipelines, bounds, and level-of-detail tables count as layout -- if you change those, reset 'layout' to force a rebuild)
+	void restore(Snapshot const &snapshot);
+
+	//layout this scene was last restored from (or copied from a scene restored from):
+	std::shared_ptr< Snapshot::Layout const > layout;
 };
@@ -0,0 +1,77 @@
+#include "SceneFile.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+SceneFile::SceneFile(std::string const &filename) : file(filename) {
+	try {
+		ChunkReader chunks(file);
+		transforms = chunks.view< TransformEntry >(chunks.get("xfh3"), &transform_count);
+		names = chunks.view< NameEntry >(chunks.get("nam2"), &name_count);
+		meshes = chunks.view< MeshEntry >(chunks.get("msh2"), &mesh_count);
+		cameras = chunks.view< CameraEntry >(chunks.get("cam0"), &camera_count);
+		lights = chunks.view< LightEntry >(chunks.get("lmp0"), &light_count);
+		ChunkReader::Chunk const &str0 = chunks.get("str0");
+		strings = chunks.view< char >(str0, &string_count);
+		extra = str0.data + str0.size;
+		extra_end = std::max(extra, chunks.end);
+	} catch (std::exception &e) {
+		throw std::runtime_error("Scene file '" + filename + "' is not a valid version 2 scene: " + e.what());
+	}
+
+	//check indices once here, so users can follow them without checking:
+	for (size_t i = 0; i < name_count; ++i) {
+		if (!(names[i].begin <= names[i].end && names[i].end <= string_count)) {
+			throw std::runtime_error("Scene file '" + filename + "' has a name with an out-of-range begin/end.");
+		}
+		if (i > 0 && names[i-1].hash > names[i].hash) {
+			throw std::runtime_error("Scene file '" + filename + "' has names that aren't sorted by hash.");
+		}
+	}
+	for (size_t i = 0; i < transform_count; ++i) {
+		if (transforms[i].parent != -1U && transforms[i].parent >= i) {
+			throw std::runtime_error("Scene file '" + filename + "' did not contain transforms in topological-sort order.");
+		}
+		if (transforms[i].name >= name_count) {
+			throw std::runtime_error("Scene file '" + filename + "' has a transform with an out-of-range name index.");
+		}
+	}
+	for (size_t i = 0; i < mesh_count; ++i) {
+		if (meshes[i].transform >= transform_count || meshes[i].name >= name_count) {
+			throw std::runtime_error("Scene file '" + filename + "' has a mesh entry with an out-of-range transform or name index.");
+		}
+	}
+	for (size_t i = 0; i < camera_count; ++i) {
+		if (cameras[i].transform >= transform_count) {
+			throw std::runtime_error("Scene file '" + filename + "' contains camera entry with invalid transform index (" + std::to_string(cameras[i].transform) + ")");
+		}
+	}
+	for (size_t i = 0; i < light_count; ++i) {
+		if (lights[i].transform >= transform_count) {
+			throw std::runtime_error("Scene file '" + filename + "' contains lamp entry with invalid transform index (" + std::to_string(lights[i].transform) + ")");
+		}
+	}
+}
+
+bool SceneFile::is_v2(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	char magic[4];
+	if (!in.read(magic, 4)) return false;
+	//(an outdated "xfh2" file counts too, so opening it reports that it needs converting again)
+	return std::string(magic, 4) == "xfh3" || std::string(magic, 4) == "xfh2";
+}
+
+uint32_t SceneFile::find_name(std::string_view text) const {
+	uint64_t hash = hash_name(text);
+	NameEntry const *first = std::lower_bound(names, names + name_count, hash, [](NameEntry const &entry, uint64_t h) {
+		return entry.hash < h;
+	});
+	for (NameEntry const *entry = first; entry != names + name_count && entry->hash == hash; ++entry) {
+		uint32_t index = uint32_t(entry - names);
+		if (name(index) == text) return index;
+	}
+	return -1U;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+/*
+ * SceneFile is a read-only view of a version 2 scene file, mapped into memory
+ * and used in place (no per-entry parsing or copying; see MappedFile.hpp).
+ *
+ * Version 1 (written by scenes/export-scene.py) stores names as (begin,end) ranges
+ * repeated for every use and leaves hierarchy order and world matrices to the loader.
+ * Version 2 (written by scenes/convert-scene from a version 1 file) stores, as
+ * chunks (see read_write_chunk.hpp) in this order:
+ *
+ *  "xfh3": TransformEntry[] -- parent index (always an *earlier* entry, or -1U), name index,
+ *                              and local position/rotation/scale
+ *                              (early "xfh2" files also stored an unused world matrix; re-run convert-scene on those)
+ *  "nam2": NameEntry[]      -- every distinct name once (interned), sorted by hash, with its hash
+ *  "msh2": MeshEntry[]      -- transform index and mesh name index for each drawable
+ *  "cam0": CameraEntry[]    -- as in version 1
+ *  "lmp0": LightEntry[]     -- as in version 1
+ *  "str0": char[]           -- name characters (the version 1 chunk, unchanged, so extra chunks' name ranges still work)
+ *  ...followed by any extra chunks (see Scene::load_extra), copied from the version 1 file,
+ *  and a "crc0" chunk of checksums (see ChunkWriter), which are checked as the file is opened.
+ *
+ * (the 8-byte-aligned chunks come first, so every chunk is aligned for its entries where it sits)
+ *
+ * Scene::load reads either version; a version 2 file is recognized by its first chunk.
+ *
+ */
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//hash used for interned names (64-bit FNV-1a of the name's bytes):
+inline uint64_t hash_name(std::string_view name) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (char c : name) {
+		hash = (hash ^ uint64_t(uint8_t(c))) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+struct SceneFile {
+	//map 'filename' and check its structure (checksums, indices in range, parents before children); throws on malformed data:
+	explicit SceneFile(std::string const &filename);
+
+	//does 'filename' start like a version 2 scene file? (false if it can't be read)
+	static bool is_v2(std::string const &filename);
+
+	//on-disk records:
+	struct TransformEntry {
+		uint32_t parent; //index of an earlier TransformEntry, or -1U for none
+		uint32_t name; //index into names
+		float position[3];
+		float rotation[4]; //quaternion, stored x,y,z,w (as glm::quat is in memory)
+		float scale[3];
+	};
+	static_assert(sizeof(TransformEntry) == 4 + 4 + 4*3 + 4*4 + 4*3, "TransformEntry is packed.");
+
+	struct NameEntry {
+		uint64_t hash; //hash_name() of the name
+		uint32_t begin, end; //range in strings
+	};
+	static_assert(sizeof(NameEntry) == 16, "NameEntry is packed.");
+
+	struct MeshEntry {
+		uint32_t transform; //index into transforms
+		uint32_t name; //index into names
+	};
+	static_assert(sizeof(MeshEntry) == 8, "MeshEntry is packed.");
+
+	struct CameraEntry {
+		uint32_t transform;
+		char type[4]; //"pers" or "orth"
+		float data; //fov in degrees for 'pers', scale for 'orth'
+		float clip_near, clip_far;
+	};
+	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
+
+	struct LightEntry {
+		uint32_t transform;
+		char type; //'p'oint, 'h'emisphere, 's'pot, or 'd'irectional
+		uint8_t color[3];
+		float energy;
+		float distance;
+		float fov; //degrees
+	};
+	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
+
+	//the file's chunks, in place:
+	TransformEntry const *transforms = nullptr;
+	size_t transform_count = 0;
+	NameEntry const *names = nullptr;
+	size_t name_count = 0;
+	MeshEntry const *meshes = nullptr;
+	size_t mesh_count = 0;
+	CameraEntry const *cameras = nullptr;
+	size_t camera_count = 0;
+	LightEntry const *lights = nullptr;
+	size_t light_count = 0;
+	char const *strings = nullptr;
+	size_t string_count = 0;
+	char const *extra = nullptr; //any chunks after str0..
+	char const *extra_end = nullptr; //..up to here (the checksum chunk, if there is one, or file.end())
+
+	//text of names[index]:
+	std::string_view name(uint32_t index) const {
+		return std::string_view(strings + names[index].begin, names[index].end - names[index].begin);
+	}
+
+	//index of 'name' in names (by hash, then text), or -1U if no entry uses it:
+	uint32_t find_name(std::string_view name) const;
+
+	MappedFile file;
+};
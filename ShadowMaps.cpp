@@ -0,0 +1,229 @@
+#include "ShadowMaps.hpp"
+
+#include "ClusteredLights.hpp"
+#include "DepthProgram.hpp"
+#include "gl_errors.hpp"
+#include "gl_stats.hpp"
+#include "Profiler.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+//FNV-1a, continued from 'hash':
+static uint64_t hash_bytes(uint64_t hash, void const *data, size_t size) {
+	unsigned char const *bytes = reinterpret_cast< unsigned char const * >(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+ShadowMaps::ShadowMaps() {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, Layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	//linear + compare gives each lookup a 2x2 filtered comparison:
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Shadow map framebuffer is incomplete.");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	rendered_signatures.fill(0);
+
+	GL_ERRORS();
+}
+
+ShadowMaps::~ShadowMaps() {
+	glDeleteFramebuffers(1, &framebuffer);
+	framebuffer = 0;
+	glDeleteTextures(1, &texture);
+	texture = 0;
+}
+
+glm::uvec2 ShadowMaps::layers_of(Scene::Light const *light) const {
+	for (auto const &s : shadowed) {
+		if (s.light == light) return s.layers;
+	}
+	return glm::uvec2(0);
+}
+
+void ShadowMaps::update(Scene const &scene, Scene::Camera const &camera) {
+	PROFILE_SCOPE("ShadowMaps::update");
+	assert(camera.transform);
+
+	//------ choose lights and compute layer matrices ------
+
+	shadowed.clear();
+	std::array< glm::mat4, Layers > world_to_clip;
+	uint32_t layer = 0;
+
+	//directional light -> cascades:
+	for (auto const &light : scene.lights) {
+		if (light.type != Scene::Light::Directional) continue;
+		shadowed.emplace_back(Shadowed{&light, glm::uvec2(layer, Cascades)});
+
+		glm::mat4x3 light_to_world = light.transform->make_local_to_world();
+		glm::vec3 direction = -glm::normalize(light_to_world[2]);
+		glm::vec3 up = (std::abs(direction.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 world_to_light = glm::lookAt(glm::vec3(0.0f), direction, up); //(rotation only; each cascade places its own box)
+
+		glm::mat4x3 camera_to_world = camera.transform->make_local_to_world();
+		float const tan_y = std::tan(0.5f * camera.fovy);
+		float const tan_x = tan_y * camera.aspect;
+
+		float split_near = camera.near;
+		for (uint32_t c = 0; c < Cascades; ++c) {
+			//practical split scheme: blend of even and logarithmic splits:
+			float t = float(c + 1) / float(Cascades);
+			float split_far = glm::mix(
+				camera.near + (shadow_distance - camera.near) * t,
+				camera.near * std::pow(shadow_distance / camera.near, t),
+				cascade_lambda
+			);
+			frame_block.CASCADE_SPLITS[c] = split_far;
+
+			//bounding sphere of this slice of the view frustum:
+			glm::vec3 corners[8];
+			for (uint32_t i = 0; i < 8; ++i) {
+				float d = (i & 4 ? split_far : split_near);
+				glm::vec3 at_view = glm::vec3((i & 1 ? 1.0f : -1.0f) * tan_x * d, (i & 2 ? 1.0f : -1.0f) * tan_y * d, -d);
+				corners[i] = camera_to_world * glm::vec4(at_view, 1.0f);
+			}
+			glm::vec3 center = glm::vec3(0.0f);
+			for (auto const &corner : corners) center += corner;
+			center /= 8.0f;
+			float radius = 0.0f;
+			for (auto const &corner : corners) radius = std::max(radius, glm::length(corner - center));
+			radius = std::ceil(radius * 16.0f) / 16.0f; //(quantized so the box size doesn't jitter)
+
+			//snap the box to whole texels in light space, so moving the camera doesn't crawl the shadow edges:
+			float texel = 2.0f * radius / float(size);
+			glm::vec3 at = glm::vec3(world_to_light * glm::vec4(center, 1.0f));
+			at.x = std::floor(at.x / texel) * texel;
+			at.y = std::floor(at.y / texel) * texel;
+
+			//n.b. light space looks along -z, so depth in front of the light is -z:
+			glm::mat4 light_to_clip = glm::ortho(
+				at.x - radius, at.x + radius,
+				at.y - radius, at.y + radius,
+				-at.z - radius - caster_margin, -at.z + radius
+			);
+			world_to_clip[layer] = light_to_clip * world_to_light;
+			layer += 1;
+
+			split_near = split_far;
+		}
+		break; //(only the first directional light is shadowed)
+	}
+
+	//spot lights -> one layer each:
+	for (auto const &light : scene.lights) {
+		if (light.type != Scene::Light::Spot) continue;
+		if (layer >= Layers) break;
+		float range = light_range(light, min_energy);
+		if (!(range > spot_near)) continue;
+		shadowed.emplace_back(Shadowed{&light, glm::uvec2(layer, 1)});
+
+		glm::mat4x3 light_to_world = light.transform->make_local_to_world();
+		glm::vec3 position = light_to_world[3];
+		glm::vec3 direction = -glm::normalize(light_to_world[2]);
+		glm::vec3 up = glm::normalize(light_to_world[1]);
+		world_to_clip[layer] = glm::perspective(light.spot_fov, 1.0f, spot_near, range) * glm::lookAt(position, position + direction, up);
+		layer += 1;
+	}
+
+	layers_used = layer;
+
+	//clip space -> (s,t,depth) in [0,1]:
+	glm::mat4 const clip_to_texture = glm::mat4(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 0.0f,
+		0.5f, 0.5f, 0.5f, 1.0f
+	);
+	for (uint32_t l = 0; l < layers_used; ++l) {
+		frame_block.WORLD_TO_SHADOW[l] = clip_to_texture * world_to_clip[l];
+	}
+
+	//------ render layers that changed ------
+
+	//everything that can cast, hashed (any change re-renders every layer):
+	uint64_t casters = 0xcbf29ce484222325ULL;
+	if (cache) {
+		for (auto const &drawable : scene.drawables) {
+			Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+			if (!(pipeline.object_block && pipeline.vao != 0 && pipeline.count != 0)) continue;
+			glm::mat4x3 local_to_world = drawable.transform->make_local_to_world();
+			casters = hash_bytes(casters, &local_to_world, sizeof(local_to_world));
+			//(the range actually drawn, which changes with the drawable's level of detail)
+			GLuint start = pipeline.start, count = pipeline.count;
+			if (drawable.lod > 0 && drawable.lod <= drawable.lod_count) {
+				start = drawable.lods[drawable.lod - 1].start;
+				count = drawable.lods[drawable.lod - 1].count;
+			}
+			GLuint const range[4] = {pipeline.vao, GLuint(pipeline.type), start, count};
+			casters = hash_bytes(casters, range, sizeof(range));
+		}
+	}
+
+	layers_rendered = 0;
+	if (layers_used) {
+		//save the state the depth passes change:
+		GLint old_framebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &old_framebuffer);
+		GLint old_viewport[4];
+		glGetIntegerv(GL_VIEWPORT, old_viewport);
+		GLboolean old_depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, size, size);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		//slope-scaled bias against self-shadowing ("acne"):
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+
+		for (uint32_t l = 0; l < layers_used; ++l) {
+			uint64_t signature = hash_bytes(casters, &world_to_clip[l], sizeof(world_to_clip[l])) | 1; //(never 0)
+			if (cache && rendered_signatures[l] == signature) continue;
+
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, l);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			scene.draw_depth(world_to_clip[l], depth_program->program);
+
+			rendered_signatures[l] = (cache ? signature : 0);
+			layers_rendered += 1;
+		}
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(0.0f, 0.0f);
+		if (!old_depth_test) glDisable(GL_DEPTH_TEST);
+		glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
+		glBindFramebuffer(GL_FRAMEBUFFER, old_framebuffer);
+	}
+
+	//bound even when unused, so the program's shadow sampler always refers to a depth texture:
+	glActiveTexture(GL_TEXTURE0 + ShadowTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glActiveTexture(GL_TEXTURE0);
+	gl_stats.state_changes += 1;
+
+	GL_ERRORS();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+ * ShadowMaps renders depth maps for a scene's shadow-casting lights into
+ * the layers of one depth texture array, which LitColorTextureProgram
+ * samples (with 3x3 PCF) through a sampler2DArrayShadow.
+ *
+ *  - The first directional light gets Cascades layers, each fit to a
+ *    slice of the camera's view (bounding spheres snapped to whole
+ *    texels, so the cascades don't shimmer or change as the camera turns).
+ *  - The first MaxSpots spot lights (in scene order) get one layer each.
+ *
+ * Depth passes draw with DepthProgram via Scene::draw_depth (no textures,
+ * no lighting). When 'cache' is set, a layer is only re-rendered if its
+ * light matrix or any caster (transform or mesh range) changed since it
+ * was last drawn -- so a still scene re-renders nothing.
+ *
+ * update() writes the layer matrices and cascade splits into frame_block
+ * (UniformBlocks.hpp); pass the ShadowMaps to ClusteredLights::update
+ * so light records point at their layers.
+ *
+ */
+
+#include "GL.hpp"
+#include "Scene.hpp"
+#include "UniformBlocks.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//texture unit the shadow map array is bound to (after the ClusteredLights units):
+constexpr GLuint ShadowTextureUnit = Scene::Drawable::Pipeline::TextureCount + 3;
+
+struct ShadowMaps {
+	ShadowMaps();
+	~ShadowMaps();
+	ShadowMaps(ShadowMaps const &) = delete;
+	ShadowMaps &operator=(ShadowMaps const &) = delete;
+
+	enum : uint32_t {
+		Cascades = 4,
+		MaxSpots = 4,
+		Layers = Cascades + MaxSpots
+	};
+	static_assert(Layers <= MaxShadowLayers, "FrameBlock has a matrix for every layer.");
+
+	uint32_t const size = 1024; //texels per side of each layer
+
+	float shadow_distance = 40.0f; //cascades cover view depths up to this (beyond, directional light is unshadowed)
+	float cascade_lambda = 0.75f; //cascade split blend: 0 = even splits, 1 = logarithmic
+	float caster_margin = 50.0f; //how far toward the light (beyond the view) cascades still catch casters
+	float spot_near = 0.05f; //near plane of spot light projections
+	float min_energy = 1.0f / 64.0f; //for spot light reach when it has no distance (see light_range())
+	bool cache = true; //reuse layers whose light and casters haven't changed
+
+	//choose shadowed lights, render any layers that changed, write matrices to frame_block, and bind the maps:
+	void update(Scene const &scene, Scene::Camera const &camera);
+
+	//(first layer, layer count) of a light's maps from the last update(); count is zero if it has none:
+	glm::uvec2 layers_of(Scene::Light const *light) const;
+
+	//stats from the last update():
+	uint32_t layers_used = 0;
+	uint32_t layers_rendered = 0;
+
+	//shadowed lights from the last update():
+	struct Shadowed {
+		Scene::Light const *light;
+		glm::uvec2 layers;
+	};
+	std::vector< Shadowed > shadowed;
+
+	GLuint texture = 0; //GL_TEXTURE_2D_ARRAY of depth, with compare mode set
+	GLuint framebuffer = 0; //depth-only, re-attached to each layer to render it
+
+	//hash of the light matrix and casters each layer was last rendered with (0: never):
+	std::array< uint64_t, Layers > rendered_signatures;
+};
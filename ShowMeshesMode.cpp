@@ -101,7 +101,7 @@ bool ShowMeshesMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window
 	return false;
 }
 
-void ShowMeshesMode::draw(glm::uvec2 const &drawable_size) {
+void ShowMeshesMode::draw(glm::uvec2 const &drawable_size, float alpha) {
 	//--- use camera structure to set up scene camera ---
 
 	scene_camera->transform->rotation =
@@ -16,7 +16,7 @@ struct ShowMeshesMode : Mode {
 	virtual ~ShowMeshesMode();
 
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
-	virtual void draw(glm::uvec2 const &drawable_size) override;
+	virtual void draw(glm::uvec2 const &drawable_size, float alpha) override;
 
 	//z-up trackball-style camera controls:
 	struct {
@@ -88,7 +88,7 @@ ShowMeshesProgram::ShowMeshesProgram() {
 }
 
 ShowMeshesProgram::~ShowMeshesProgram() {
-	glDeleteProgram(program);
+	gl_release_program(program);
 	program = 0;
 }
 
@@ -2,8 +2,12 @@
 #include "DrawLines.hpp"
 
 #include <iostream>
+#include <functional>
 
-ShowSceneMode::ShowSceneMode(Scene const &scene_) : scene(scene_) {
+ShowSceneMode::ShowSceneMode(Scene &scene_) : scene(scene_) {
+	//each viewer gets its own retained batch, so viewers of different scenes don't replay each other's lines:
+	static uint32_t next_instance = 0;
+	lines_batch = "ShowSceneMode::scene#" + std::to_string(next_instance++);
 
 	//Set up camera-only scene:
 	{ //create a single camera:
@@ -17,6 +21,7 @@ ShowSceneMode::ShowSceneMode(Scene const &scene_) : scene(scene_) {
 }
 
 ShowSceneMode::~ShowSceneMode() {
+	DrawLines::forget_retained(lines_batch);
 }
 
 bool ShowSceneMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
@@ -72,7 +77,7 @@ bool ShowSceneMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_
 	return false;
 }
 
-void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
+void ShowSceneMode::draw(glm::uvec2 const &drawable_size, float alpha) {
 	//--- use camera structure to set up scene camera ---
 
 	scene_camera->transform->rotation =
@@ -91,43 +96,59 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 
+	scene.update_lods(scene_camera->make_world_to_clip(), float(drawable_size.y));
 	scene.draw(*scene_camera);
 
 	{ //decorate with some lines:
 		DrawLines draw_lines(scene_camera->make_projection() * glm::mat4(scene_camera->transform->make_world_to_local()));
-		for (auto &transform : scene.transforms) {
-			glm::mat4 local_to_world = transform.make_local_to_world();
-			auto xf = [&local_to_world](glm::vec3 const &vec) {
-				return glm::vec3(local_to_world * glm::vec4(vec, 1.0f));
-			};
-			auto xfd = [&local_to_world](glm::vec3 const &vec) {
-				return glm::vec3(local_to_world * glm::vec4(vec, 0.0f));
-			};
-
-			if (transform.parent) {
-				//connect to parent:
-				glm::vec3 p = glm::vec3(transform.parent->make_local_to_world()[3]);
-				draw_lines.draw(p, xf(glm::vec3(0.0f)), glm::u8vec4(0xff, 0xff, 0x00, 0xff));
+		//the viewed scene rarely changes, so its decorations are kept in a retained batch,
+		// re-recorded only when a transform's name or world placement (which is all they show) changes:
+		size_t content_hash = scene.transforms.size();
+		auto mix = [&content_hash](size_t v) { content_hash ^= v + 0x9e3779b97f4a7c15ULL + (content_hash << 6) + (content_hash >> 2); };
+		for (auto const &transform : scene.transforms) {
+			mix(std::hash< std::string >{}(transform.name));
+			glm::mat4x3 local_to_world = transform.make_local_to_world();
+			for (uint32_t c = 0; c < 4; ++c) {
+				for (uint32_t r = 0; r < 3; ++r) {
+					mix(std::hash< float >{}(local_to_world[c][r]));
+				}
 			}
-
-
-			//axis:
-			float len = 0.2f;
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(len, 0.0f, 0.0f)), glm::u8vec4(0xff, 0x00, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(-len, 0.0f, 0.0f)), glm::u8vec4(0x88, 0x00, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, len, 0.0f)), glm::u8vec4(0x00, 0xff, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, -len, 0.0f)), glm::u8vec4(0x00, 0x88, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, len)), glm::u8vec4(0x00, 0x00, 0xff, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, -len)), glm::u8vec4(0x00, 0x00, 0x88, 0xff));
-
-			//transform name:
-			draw_lines.draw_text("'" + transform.name + "'",
-				xf(glm::vec3(0.05f, 0.0f, 0.05f)),
-				0.15f * xfd(glm::vec3(1.0f, 0.0f, 0.0f)),
-				0.15f * xfd(glm::vec3(0.0f, 0.0f, 1.0f)),
-				glm::u8vec4(0xff, 0xff, 0xff, 0xff)
-			);
 		}
+		draw_lines.draw_retained(lines_batch, content_hash, [this](DrawLines &lines){
+			for (auto &transform : scene.transforms) {
+				glm::mat4 local_to_world = transform.make_local_to_world();
+				auto xf = [&local_to_world](glm::vec3 const &vec) {
+					return glm::vec3(local_to_world * glm::vec4(vec, 1.0f));
+				};
+				auto xfd = [&local_to_world](glm::vec3 const &vec) {
+					return glm::vec3(local_to_world * glm::vec4(vec, 0.0f));
+				};
+
+				if (transform.parent) {
+					//connect to parent:
+					glm::vec3 p = glm::vec3(transform.parent->make_local_to_world()[3]);
+					lines.draw(p, xf(glm::vec3(0.0f)), glm::u8vec4(0xff, 0xff, 0x00, 0xff));
+				}
+
+
+				//axis:
+				float len = 0.2f;
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(len, 0.0f, 0.0f)), glm::u8vec4(0xff, 0x00, 0x00, 0xff));
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(-len, 0.0f, 0.0f)), glm::u8vec4(0x88, 0x00, 0x00, 0xff));
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, len, 0.0f)), glm::u8vec4(0x00, 0xff, 0x00, 0xff));
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, -len, 0.0f)), glm::u8vec4(0x00, 0x88, 0x00, 0xff));
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, len)), glm::u8vec4(0x00, 0x00, 0xff, 0xff));
+				lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, -len)), glm::u8vec4(0x00, 0x00, 0x88, 0xff));
+
+				//transform name:
+				lines.draw_text("'" + transform.name + "'",
+					xf(glm::vec3(0.05f, 0.0f, 0.05f)),
+					0.15f * xfd(glm::vec3(1.0f, 0.0f, 0.0f)),
+					0.15f * xfd(glm::vec3(0.0f, 0.0f, 1.0f)),
+					glm::u8vec4(0xff, 0xff, 0xff, 0xff)
+				);
+			}
+		});
 		/*
 		glEnable(GL_LINE_SMOOTH);
 		glEnable(GL_BLEND);
@@ -12,11 +12,11 @@
 #include "Mesh.hpp"
 
 struct ShowSceneMode : Mode {
-	ShowSceneMode(Scene const &scene);
+	ShowSceneMode(Scene &scene);
 	virtual ~ShowSceneMode();
 
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
-	virtual void draw(glm::uvec2 const &drawable_size) override;
+	virtual void draw(glm::uvec2 const &drawable_size, float alpha) override;
 
 	//z-up trackball-style camera controls:
 	struct {
@@ -28,7 +28,10 @@ struct ShowSceneMode : Mode {
 	} camera;
 
 	//Scene being viewed:
-	Scene const &scene;
+	Scene &scene; //(not const: levels of detail are picked per frame)
+
+	//name of this viewer's retained DrawLines batch (of transform axes, links, and names):
+	std::string lines_batch;
 
 	//mode uses a secondary Scene to hold a camera:
 	Scene camera_scene;
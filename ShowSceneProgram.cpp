@@ -88,7 +88,7 @@ ShowSceneProgram::ShowSceneProgram() {
 }
 
 ShowSceneProgram::~ShowSceneProgram() {
-	glDeleteProgram(program);
+	gl_release_program(program);
 	program = 0;
 }
 
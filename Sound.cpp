@@ -1,12 +1,17 @@
 #include "Sound.hpp"
 #include "load_wav.hpp"
 #include "load_opus.hpp"
+#include "Profiler.hpp"
 #include <chrono>
 #include <SDL.h>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <list>
 #include <cassert>
 #include <exception>
+#include <stdexcept>
 #include <iostream>
 #include <algorithm>
 
@@ -23,6 +28,51 @@ namespace {
 	//list of all currently playing samples:
 	std::list< std::shared_ptr< Sound::PlayingSample > > playing_samples;
 
+	//id for the next PlayingSample (only touched by the game thread):
+	uint32_t next_playing_sample_id = 1;
+
+	//events from the mixer to the game thread, as a single-producer (audio callback), single-consumer (poll_event) ring:
+	constexpr uint32_t const EVENT_CAPACITY = 256; //n.b. power of two, so head/tail wrap-around works out
+	std::array< Sound::Event, EVENT_CAPACITY > events;
+	std::atomic< uint32_t > events_head(0); //count of events ever pushed; written only by producer
+	std::atomic< uint32_t > events_tail(0); //count of events ever popped; written only by consumer
+
+	//returns false if the event didn't fit (the mixer never blocks on a full ring):
+	// 'Looped' events are advisory, so they are dropped once the ring is half full, leaving room for 'Finished' events;
+	// a 'Finished' event that doesn't fit is kept by the caller and pushed again later (see mix_audio and start_playing).
+	bool push_event(Sound::Event::Type type, uint32_t id) {
+		uint32_t head = events_head.load(std::memory_order_relaxed);
+		uint32_t tail = events_tail.load(std::memory_order_acquire);
+		uint32_t limit = (type == Sound::Event::Finished ? EVENT_CAPACITY : EVENT_CAPACITY / 2);
+		if (head - tail >= limit) return false;
+		events[head % EVENT_CAPACITY].type = type;
+		events[head % EVENT_CAPACITY].id = id;
+		events_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//'Finished' events that didn't fit in the ring when there was no audio device (only touched by the game thread):
+	std::deque< uint32_t > unpushed_finished;
+
+	//assign an id and hand a new PlayingSample to the mixer:
+	std::shared_ptr< Sound::PlayingSample > start_playing(std::shared_ptr< Sound::PlayingSample > const &playing_sample) {
+		playing_sample->id = next_playing_sample_id++;
+		if (next_playing_sample_id == 0) next_playing_sample_id = 1; //(0 is never a valid id)
+
+		if (device == 0) {
+			//no audio device, so no mixer thread: finish right away so anyone waiting on this sample still hears about it.
+			// (the game thread is the only producer in this case)
+			playing_sample->stopped = true;
+			if (!push_event(Sound::Event::Finished, playing_sample->id)) unpushed_finished.emplace_back(playing_sample->id);
+			return playing_sample;
+		}
+
+		Sound::lock();
+		playing_samples.emplace_back(playing_sample);
+		Sound::unlock();
+		return playing_sample;
+	}
+
 }
 
 //public-facing data:
@@ -100,40 +150,40 @@ void Sound::unlock() {
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::play(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, false));
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::play_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, false));
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, true));
 }
 
 
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, true));
 }
 
 
+bool Sound::poll_event(Event *event) {
+	assert(event);
+	uint32_t tail = events_tail.load(std::memory_order_relaxed);
+	uint32_t head = events_head.load(std::memory_order_acquire);
+	if (tail == head) {
+		if (unpushed_finished.empty()) return false;
+		event->type = Event::Finished;
+		event->id = unpushed_finished.front();
+		unpushed_finished.pop_front();
+		return true;
+	}
+	*event = events[tail % EVENT_CAPACITY];
+	events_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
 void Sound::stop_all_samples() {
 	lock();
 	for (auto &s : playing_samples) {
@@ -142,6 +192,21 @@ void Sound::stop_all_samples() {
 	unlock();
 }
 
+void Sound::replace_data(Sample const &sample, std::vector< float > &&data) {
+	if (data.empty()) throw std::runtime_error("Can't replace sample data with nothing.");
+	lock();
+	//(PlayingSample's refer to sample.data, so it is swapped in place rather than replaced)
+	const_cast< std::vector< float > & >(sample.data).swap(data);
+	for (auto &s : playing_samples) {
+		if (&s->data == &sample.data && s->i >= sample.data.size()) {
+			s->i = 0;
+			s->stopping = true;
+			s->volume.set(0.0f, 0.0f);
+		}
+	}
+	unlock();
+}
+
 void Sound::set_volume(float new_volume, float ramp) {
 	lock();
 	volume.set(new_volume, ramp);
@@ -312,6 +377,7 @@ void step_direction_ramp(Sound::Ramp< glm::vec3 > &ramp) {
 
 //The audio callback -- invoked by SDL when it needs more sound to play:
 void mix_audio(void *, Uint8 *buffer_, int len) {
+	PROFILE_SCOPE("mix_audio");
 	assert(buffer_); //should always have some audio buffer
 
 	struct LR {
@@ -345,6 +411,18 @@ void mix_audio(void *, Uint8 *buffer_, int len) {
 	for (auto si = playing_samples.begin(); si != playing_samples.end(); /* later */) {
 		Sound::PlayingSample &playing_sample = **si; //much more convenient than writing ** everywhere.
 
+		//finished on an earlier call, but the event ring was full -- try reporting it again:
+		if (playing_sample.stopped) {
+			if (push_event(Sound::Event::Finished, playing_sample.id)) {
+				auto old = si;
+				++si;
+				playing_samples.erase(old);
+			} else {
+				++si;
+			}
+			continue;
+		}
+
 		//Figure out sample panning/volume at start...
 		LR start_pan;
 		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
@@ -403,6 +481,7 @@ void mix_audio(void *, Uint8 *buffer_, int len) {
 			if (playing_sample.i == playing_sample.data.size()) {
 				if (playing_sample.loop) {
 					playing_sample.i = 0;
+					push_event(Sound::Event::Looped, playing_sample.id);
 				} else {
 					break;
 				}
@@ -416,10 +495,15 @@ void mix_audio(void *, Uint8 *buffer_, int len) {
 		if (playing_sample.i >= playing_sample.data.size()
 		 || (playing_sample.stopping && playing_sample.volume.value == 0.0f)) { //sample has finished
 		 	playing_sample.stopped = true;
-			//erase from list:
-			auto old = si;
-			++si;
-			playing_samples.erase(old);
+			if (push_event(Sound::Event::Finished, playing_sample.id)) {
+				//erase from list:
+				auto old = si;
+				++si;
+				playing_samples.erase(old);
+			} else {
+				//(ring full: keep the sample, silent, until its event fits; see above)
+				++si;
+			}
 		} else {
 			++si;
 		}
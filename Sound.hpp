@@ -67,6 +67,7 @@ struct PlayingSample {
 	//NOTE: PlayingSample is used in a separate thread; so setting these values directly
 	// may result in bad results. Instead, use the functions above, which perform locking!
 	std::vector< float > const &data; //reference to sample data being played
+	uint32_t id = 0; //identifies this playback in Sound::Event's (assigned by the play/loop functions)
 	uint32_t i = 0; //next data value to read
 	bool loop = false; //should playback loop after data runs out?
 	bool stopping = false; //is playing stopping?
@@ -87,6 +88,15 @@ struct PlayingSample {
 		: data(sample_.data), loop(loop_), volume(volume_), position(position_), half_volume_radius(half_volume_radius_) { }
 };
 
+//Events reported by the mixer (see poll_event, below):
+struct Event {
+	enum Type : uint8_t {
+		Finished, //playback ended (ran out of sample, or was stopped)
+		Looped //a looping sample wrapped around to its start
+	} type = Finished;
+	uint32_t id = 0; //PlayingSample::id of the sample this happened to
+};
+
 // ------- global functions -------
 
 void init(); //call Sound::init() from main.cpp before using any member functions
@@ -133,9 +143,19 @@ struct Listener {
 };
 extern struct Listener listener;
 
+//Get the next event from the mixer, if any; returns false when there are no more.
+// Events are passed through a lock-free queue, so this never waits on the audio thread.
+// (call only from the game thread; if nobody polls, 'Looped' events may be dropped, but 'Finished' events never are)
+bool poll_event(Event *event);
+
 //"panic button" to shut off all currently playing sounds:
 void stop_all_samples();
 
+//Replace the data of a sample, even while it is playing (e.g., when its file is hot reloaded):
+// playbacks continue from the same position if it's still in range; otherwise they finish.
+// note: will throw if 'data' is empty.
+void replace_data(Sample const &sample, std::vector< float > &&data);
+
 //set global volume:
 void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
 extern Ramp< float > volume;
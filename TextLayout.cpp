@@ -0,0 +1,172 @@
+#include "TextLayout.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <unordered_map>
+
+TextLayout::TextLayout(GlyphAtlas const &atlas, std::string const &str, float scale, float max_width, Align align) {
+	line_height = atlas.line_height * scale;
+
+	auto advance_of = [&](char c) {
+		return atlas.glyph(c).advance * scale;
+	};
+
+	//first pass: break into lines.
+	// each line is a range of characters [begin,end) and its width (trailing spaces not included):
+	struct Line {
+		size_t begin, end;
+		float width;
+	};
+	std::vector< Line > breaks;
+
+	size_t line_begin = 0;
+	while (line_begin <= str.size()) {
+		float width = 0.0f; //width of line so far, through last complete word
+		size_t line_end = line_begin; //end of last complete word
+		float pen = 0.0f;
+		size_t i = line_begin;
+		bool hard_break = false;
+		while (i < str.size()) {
+			if (str[i] == '\n') {
+				hard_break = true;
+				break;
+			}
+			//measure next word (plus any spaces before it):
+			size_t word_end = i;
+			float word_pen = pen;
+			while (word_end < str.size() && str[word_end] == ' ') word_pen += advance_of(str[word_end++]);
+			size_t word_begin = word_end;
+			while (word_end < str.size() && str[word_end] != ' ' && str[word_end] != '\n') word_pen += advance_of(str[word_end++]);
+
+			//spaces with no word after them (at the end of the line) neither wrap nor count toward its width, so alignment ignores them:
+			bool has_word = (word_end != word_begin);
+
+			if (has_word && word_pen > max_width && line_end != line_begin) {
+				//word doesn't fit, and this isn't the first word on the line (which always goes on the line, even if it overflows):
+				break;
+			}
+			pen = word_pen;
+			if (has_word) width = word_pen;
+			line_end = word_end;
+			i = word_end;
+		}
+		if (line_end == line_begin) line_end = i; //(empty line, or line of only spaces)
+		breaks.emplace_back(Line{line_begin, line_end, width});
+
+		//skip the break itself:
+		line_begin = line_end;
+		if (hard_break && line_begin < str.size() && str[line_begin] == '\n') {
+			line_begin += 1;
+		} else {
+			while (line_begin < str.size() && str[line_begin] == ' ') line_begin += 1;
+			if (line_begin >= str.size()) break;
+		}
+	}
+
+	//second pass: place glyphs.
+	float box_width = 0.0f;
+	for (Line const &line : breaks) {
+		box_width = std::max(box_width, line.width);
+	}
+	if (max_width < std::numeric_limits< float >::infinity()) box_width = max_width;
+
+	lines = uint32_t(breaks.size());
+	size = glm::vec2(box_width, lines * line_height);
+
+	quads.reserve(str.size());
+	glm::vec2 pen = glm::vec2(0.0f);
+	for (Line const &line : breaks) {
+		pen.x = 0.0f;
+		if (align == AlignCenter) pen.x = 0.5f * (box_width - line.width);
+		else if (align == AlignRight) pen.x = box_width - line.width;
+
+		for (size_t i = line.begin; i < line.end; ++i) {
+			GlyphAtlas::Glyph const &g = atlas.glyph(str[i]);
+			if (g.size.x > 0.0f && g.size.y > 0.0f) {
+				quads.emplace_back();
+				Quad &q = quads.back();
+				q.min = pen + glm::vec2(g.bearing.x, g.bearing.y - g.size.y) * scale;
+				q.max = q.min + g.size * scale;
+				//(glyph bitmaps are stored top row first, so the bottom of the quad gets tex_max.y)
+				q.tex_min = glm::vec2(g.tex_min.x, g.tex_max.y);
+				q.tex_max = glm::vec2(g.tex_max.x, g.tex_min.y);
+			}
+			pen.x += g.advance * scale;
+		}
+		end = pen;
+		pen.y -= line_height;
+	}
+}
+
+//------------------------------------------------
+//layout cache:
+
+namespace {
+	struct Key {
+		std::string str;
+		GlyphAtlas const *atlas;
+		float scale;
+		float max_width;
+		TextLayout::Align align;
+		bool operator==(Key const &o) const {
+			return str == o.str && atlas == o.atlas && scale == o.scale && max_width == o.max_width && align == o.align;
+		}
+	};
+	struct KeyHash {
+		size_t operator()(Key const &key) const {
+			size_t h = std::hash< std::string >{}(key.str);
+			auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2); };
+			mix(std::hash< void const * >{}(key.atlas));
+			mix(std::hash< float >{}(key.scale));
+			mix(std::hash< float >{}(key.max_width));
+			mix(size_t(key.align));
+			return h;
+		}
+	};
+	struct Entry {
+		TextLayout layout;
+		uint64_t last_use = 0;
+	};
+}
+
+//cache size at which least-recently-used layouts get evicted:
+static constexpr size_t MaxCachedLayouts = 512;
+
+static std::unordered_map< Key, Entry, KeyHash > &cache() {
+	static std::unordered_map< Key, Entry, KeyHash > cache;
+	return cache;
+}
+static uint64_t use_counter = 0;
+
+TextLayout const &TextLayout::get(GlyphAtlas const &atlas, std::string const &str, float scale, float max_width, Align align) {
+	auto &layouts = cache();
+	use_counter += 1;
+
+	Key key{str, &atlas, scale, max_width, align};
+	auto f = layouts.find(key);
+	if (f != layouts.end()) {
+		f->second.last_use = use_counter;
+		return f->second.layout;
+	}
+
+	if (layouts.size() >= MaxCachedLayouts) {
+		//evict the older half of the cache (text that changes every frame, e.g. counters, churns through here):
+		std::vector< uint64_t > uses;
+		uses.reserve(layouts.size());
+		for (auto const &kv : layouts) uses.emplace_back(kv.second.last_use);
+		auto mid = uses.begin() + uses.size() / 2;
+		std::nth_element(uses.begin(), mid, uses.end());
+		uint64_t cutoff = *mid;
+		for (auto kv = layouts.begin(); kv != layouts.end(); ) {
+			if (kv->second.last_use <= cutoff) kv = layouts.erase(kv);
+			else ++kv;
+		}
+	}
+
+	Entry &entry = layouts[std::move(key)];
+	entry.layout = TextLayout(atlas, str, scale, max_width, align);
+	entry.last_use = use_counter;
+	assert(layouts.size() <= MaxCachedLayouts);
+	return entry.layout;
+}
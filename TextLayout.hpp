@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+ * TextLayout positions the glyphs of a string (from a GlyphAtlas):
+ *  - measures the string,
+ *  - wraps it at spaces (and '\n') to fit a maximum width,
+ *  - aligns each line within the laid-out box.
+ *
+ * Layouts are cached by (string, atlas, scale, max width, alignment),
+ * so drawing the same text frame after frame does no layout work.
+ *
+ * Coordinates are in pixels, relative to the start of the first line's baseline,
+ * with +y up (lines go downward). DrawUI::text() draws these directly.
+ *
+ */
+
+#include "GlyphAtlas.hpp"
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+struct TextLayout {
+	enum Align : uint8_t {
+		AlignLeft,
+		AlignCenter,
+		AlignRight
+	};
+
+	//one quad per visible glyph, ready to draw:
+	struct Quad {
+		glm::vec2 min; //lower left, relative to anchor
+		glm::vec2 max; //upper right, relative to anchor
+		glm::vec2 tex_min; //texture coordinate at 'min'
+		glm::vec2 tex_max; //texture coordinate at 'max'
+	};
+	std::vector< Quad > quads;
+
+	glm::vec2 size = glm::vec2(0.0f); //width of the widest line (or max_width, if finite) x total height of all lines
+	uint32_t lines = 0; //number of lines after wrapping
+	float line_height = 0.0f; //baseline-to-baseline distance
+	glm::vec2 end = glm::vec2(0.0f); //pen position after the last character
+
+	//get a (cached) layout:
+	// 'max_width' of infinity means "no wrapping"; alignment is then relative to the widest line.
+	// note: the returned reference is valid until the next call to get().
+	static TextLayout const &get(GlyphAtlas const &atlas, std::string const &str, float scale,
+		float max_width = std::numeric_limits< float >::infinity(), Align align = AlignLeft);
+
+	//measure a string (same as get(...).size):
+	static glm::vec2 measure(GlyphAtlas const &atlas, std::string const &str, float scale,
+		float max_width = std::numeric_limits< float >::infinity()) {
+		return get(atlas, str, scale, max_width).size;
+	}
+
+	//build a layout without consulting the cache:
+	TextLayout(GlyphAtlas const &atlas, std::string const &str, float scale, float max_width, Align align);
+	TextLayout() = default;
+};
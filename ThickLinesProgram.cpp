@@ -0,0 +1,84 @@
+#include "ThickLinesProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+Load< ThickLinesProgram > thick_lines_program(LoadTagEarly);
+
+ThickLinesProgram::ThickLinesProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"uniform vec2 VIEWPORT_SIZE;\n"
+		"in vec3 A;\n"
+		"in vec3 B;\n"
+		"in vec4 Color;\n"
+		"in float Width;\n"
+		"out vec4 color;\n"
+		"noperspective out float across;\n" //pixels from the segment's center line
+		"flat out float halfWidth;\n"
+		"void main() {\n"
+		"	vec4 a = OBJECT_TO_CLIP * vec4(A, 1.0);\n"
+		"	vec4 b = OBJECT_TO_CLIP * vec4(B, 1.0);\n"
+		//clip the segment against the w = near plane so the divide below is safe:
+		"	const float near = 1e-5;\n"
+		"	if (a.w < near && b.w < near) {\n"
+		"		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n" //entirely behind camera; emit outside clip volume
+		"		color = vec4(0.0); across = 0.0; halfWidth = 0.0;\n"
+		"		return;\n"
+		"	}\n"
+		"	if (a.w < near) a = mix(a, b, (near - a.w) / (b.w - a.w));\n"
+		"	if (b.w < near) b = mix(b, a, (near - b.w) / (a.w - b.w));\n"
+		//segment direction in pixels:
+		"	vec2 to_pixels = 0.5 * VIEWPORT_SIZE;\n"
+		"	vec2 dir = (b.xy / b.w - a.xy / a.w) * to_pixels;\n"
+		"	float len = length(dir);\n"
+		"	dir = (len > 0.0 ? dir / len : vec2(1.0, 0.0));\n"
+		"	vec2 perp = vec2(-dir.y, dir.x);\n"
+		//gl_VertexID 0..3 picks a corner of the quad:
+		"	float along = float(gl_VertexID & 1);\n"
+		"	float side = ((gl_VertexID & 2) != 0 ? 1.0 : -1.0);\n"
+		//quad extends one extra pixel past the line's edges for antialiasing (but not past its ends, so segments keep their length):
+		"	halfWidth = 0.5 * Width;\n"
+		"	float extent = halfWidth + 1.0;\n"
+		"	vec4 p = (along == 0.0 ? a : b);\n"
+		"	vec2 offset = perp * (side * extent);\n"
+		"	p.xy += offset / to_pixels * p.w;\n"
+		"	gl_Position = p;\n"
+		"	across = side * extent;\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"noperspective in float across;\n"
+		"flat in float halfWidth;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		//analytic coverage of a one-pixel-wide box filter by the line's cross-section:
+		"	float coverage = clamp(halfWidth + 0.5 - abs(across), 0.0, 1.0);\n"
+		"	if (coverage == 0.0) discard;\n"
+		"	fragColor = vec4(color.rgb, color.a * coverage);\n"
+		"}\n"
+	);
+	//As you can see above, adjacent strings in C/C++ are concatenated.
+	// this is very useful for writing long shader programs inline.
+
+	//look up the locations of vertex attributes:
+	A_vec3 = glGetAttribLocation(program, "A");
+	B_vec3 = glGetAttribLocation(program, "B");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+	Width_float = glGetAttribLocation(program, "Width");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	VIEWPORT_SIZE_vec2 = glGetUniformLocation(program, "VIEWPORT_SIZE");
+}
+
+ThickLinesProgram::~ThickLinesProgram() {
+	gl_release_program(program);
+	program = 0;
+}
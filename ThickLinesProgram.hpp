@@ -0,0 +1,26 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws antialiased, fixed-pixel-width line segments.
+// Each segment is one *instance*; the vertex shader expands it into a
+// screen-space quad (draw with glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, segments)):
+struct ThickLinesProgram {
+	ThickLinesProgram();
+	~ThickLinesProgram();
+
+	GLuint program = 0;
+	//Attribute (per-instance variable) locations:
+	GLuint A_vec3 = -1U; //segment start
+	GLuint B_vec3 = -1U; //segment end
+	GLuint Color_vec4 = -1U;
+	GLuint Width_float = -1U; //width in pixels
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint VIEWPORT_SIZE_vec2 = -1U; //size of viewport in pixels
+	//Textures:
+	// none
+};
+
+extern Load< ThickLinesProgram > thick_lines_program;
@@ -0,0 +1,134 @@
+#include "UniformBlocks.hpp"
+
+#include "gl_errors.hpp"
+#include "gl_stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+
+FrameBlock frame_block;
+
+namespace {
+	GLuint frame_buffer = 0;
+
+	//The ring holds the ObjectBlocks of recent draws; the fences mark when the GPU is done with each range:
+	// (sized for ~100k visible objects per draw at a 256-byte offset alignment)
+	constexpr GLsizeiptr RingSize = 32 << 20;
+	GLuint ring_buffer = 0;
+	GLsizeiptr ring_head = 0; //where the next range starts
+	GLsizeiptr ring_stride = 0;
+	struct Fence {
+		GLsizeiptr begin, end;
+		GLsync sync;
+	};
+	std::deque< Fence > ring_fences; //oldest first
+
+	void init_ring() {
+		if (ring_buffer) return;
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		alignment = std::max(alignment, 1);
+		ring_stride = (GLsizeiptr(sizeof(ObjectBlock)) + alignment - 1) / alignment * alignment;
+
+		glGenBuffers(1, &ring_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, ring_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, RingSize, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	//wait for the GPU to finish with every older range overlapping [begin,end):
+	// (sizes vary from draw to draw, so an overlapping fence may sit behind ones that don't overlap;
+	//  fences complete in order, so retire them oldest-first up to and including the newest that overlaps)
+	void wait_for_range(GLsizeiptr begin, GLsizeiptr end) {
+		size_t retire = 0;
+		for (size_t i = 0; i < ring_fences.size(); ++i) {
+			if (ring_fences[i].begin < end && begin < ring_fences[i].end) retire = i + 1;
+		}
+		for (; retire > 0; --retire) {
+			GLenum result = glClientWaitSync(ring_fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+			if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+				throw std::runtime_error("Timed out waiting for the GPU to release object uniforms.");
+			}
+			glDeleteSync(ring_fences.front().sync);
+			ring_fences.pop_front();
+		}
+	}
+}
+
+void bind_uniform_blocks(GLuint program) {
+	GLuint frame = glGetUniformBlockIndex(program, "Frame");
+	if (frame != GL_INVALID_INDEX) glUniformBlockBinding(program, frame, FrameBlockBinding);
+	GLuint object = glGetUniformBlockIndex(program, "Object");
+	if (object != GL_INVALID_INDEX) glUniformBlockBinding(program, object, ObjectBlockBinding);
+}
+
+void upload_frame_block(FrameBlock const &block) {
+	if (frame_buffer == 0) {
+		glGenBuffers(1, &frame_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_STREAM_DRAW); //orphan, so the previous frame's copy needn't be waited on
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FrameBlockBinding, frame_buffer);
+	gl_stats.uniform_uploads += 1;
+	gl_stats.state_changes += 1;
+}
+
+ObjectBlocks::ObjectBlocks(uint32_t count_) : count(count_) {
+	if (count == 0) return;
+	init_ring();
+	stride = ring_stride;
+
+	GLsizeiptr size = stride * GLsizeiptr(count);
+	if (size > RingSize) {
+		throw std::runtime_error("Drawing " + std::to_string(count) + " objects needs more object uniform space than the ring has.");
+	}
+	if (ring_head + size > RingSize) {
+		//wrap around, retiring whatever sits in the skipped tail first:
+		wait_for_range(ring_head, RingSize);
+		ring_head = 0;
+	}
+	offset = ring_head;
+	wait_for_range(offset, offset + size);
+	ring_head = offset + size;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ring_buffer);
+	mapped = reinterpret_cast< char * >(glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	if (!mapped) throw std::runtime_error("Failed to map object uniform ring.");
+	gl_stats.uniform_uploads += 1;
+}
+
+ObjectBlocks::~ObjectBlocks() {
+	if (count == 0) return;
+	unmap();
+	ring_fences.emplace_back(Fence{offset, offset + stride * GLsizeiptr(count), glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+}
+
+ObjectBlock &ObjectBlocks::operator[](uint32_t i) {
+	assert(mapped && i < count);
+	return *reinterpret_cast< ObjectBlock * >(mapped + stride * GLsizeiptr(i));
+}
+
+void ObjectBlocks::unmap() {
+	if (!mapped) return;
+	glBindBuffer(GL_UNIFORM_BUFFER, ring_buffer);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	mapped = nullptr;
+}
+
+void ObjectBlocks::bind(uint32_t i) const {
+	assert(!mapped && i < count);
+	glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBlockBinding, ring_buffer, offset + stride * GLsizeiptr(i), sizeof(ObjectBlock));
+	gl_stats.state_changes += 1;
+}
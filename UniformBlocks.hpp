@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+ * std140 uniform blocks shared by scene programs (see dist/lit_color_texture.vs/.fs for the GLSL side):
+ *
+ *  "Frame" (binding FrameBlockBinding): camera and light data.
+ *     Written once per Scene::draw() and bound once, instead of being set on every program.
+ *
+ *  "Object" (binding ObjectBlockBinding): per-drawable matrices.
+ *     Scene::draw() writes every drawable's matrices into one mapped range of a large ring buffer,
+ *     then each draw binds its slice with glBindBufferRange (one call instead of three glUniform* calls).
+ *     The ring is fenced, so a range is only rewritten once the GPU has finished reading it.
+ *
+ * The structures below mirror the std140 layouts exactly (mat3 columns and vec3's are padded to vec4).
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+constexpr GLuint FrameBlockBinding = 0;
+constexpr GLuint ObjectBlockBinding = 1;
+
+constexpr uint32_t MaxShadowLayers = 8; //size of FrameBlock::WORLD_TO_SHADOW (and the GLSL side)
+
+struct FrameBlock {
+	glm::mat4 WORLD_TO_CLIP = glm::mat4(1.0f);
+	glm::mat4 WORLD_TO_LIGHT = glm::mat4(1.0f);
+
+	//light (xyz used):
+	glm::vec4 LIGHT_LOCATION = glm::vec4(0.0f);
+	glm::vec4 LIGHT_DIRECTION = glm::vec4(0.0f, 0.0f,-1.0f, 0.0f);
+	glm::vec4 LIGHT_ENERGY = glm::vec4(1.0f);
+	int32_t LIGHT_TYPE = 1; //0: point, 1: hemisphere, 2: spot, 3: directional, -1: none
+	float LIGHT_CUTOFF = 1.0f; //cosine of spot light half-angle
+	float padding_[2] = {0.0f, 0.0f};
+
+	//clustered lights (written by ClusteredLights::update):
+	glm::mat4 WORLD_TO_VIEW = glm::mat4(1.0f);
+	glm::vec4 CLUSTER_SCALE = glm::vec4(0.0f); //tiles per pixel (x,y), depth slice scale and bias (of log(depth))
+	glm::ivec4 CLUSTER_COUNT = glm::ivec4(0); //tiles x, tiles y, slices (zero: no clustered lights), global lights
+
+	//shadow maps (written by ShadowMaps::update):
+	glm::mat4 WORLD_TO_SHADOW[MaxShadowLayers]; //world to shadow map (s,t,depth) for each layer, before divide by w
+	glm::vec4 CASCADE_SPLITS = glm::vec4(0.0f); //far view depth of each cascade
+};
+static_assert(sizeof(FrameBlock) == 288 + 64 * MaxShadowLayers + 16, "FrameBlock matches std140 layout");
+
+struct ObjectBlock {
+	glm::mat4 OBJECT_TO_CLIP;
+	glm::mat4 OBJECT_TO_LIGHT;
+	glm::vec4 NORMAL_TO_LIGHT[3]; //mat3 (columns padded to vec4)
+};
+static_assert(sizeof(ObjectBlock) == 176, "ObjectBlock matches std140 layout");
+
+//light settings for the next Scene::draw() (camera matrices are filled in by Scene::draw() itself):
+extern FrameBlock frame_block;
+
+//bind a program's "Frame" and "Object" blocks (whichever it has) to the binding points above:
+// (call after linking; binding points are program state)
+void bind_uniform_blocks(GLuint program);
+
+//upload 'block' to the Frame uniform buffer and bind it at FrameBlockBinding:
+void upload_frame_block(FrameBlock const &block);
+
+//A run of ObjectBlocks written to the ring buffer:
+struct ObjectBlocks {
+	//map space for 'count' blocks (which may wait on the GPU if the ring is full):
+	explicit ObjectBlocks(uint32_t count);
+	//unmaps (if still mapped) and fences the range, so call once all the draws using it are issued:
+	~ObjectBlocks();
+	ObjectBlocks(ObjectBlocks const &) = delete;
+	ObjectBlocks &operator=(ObjectBlocks const &) = delete;
+
+	//write block 'i' (only while mapped):
+	ObjectBlock &operator[](uint32_t i);
+
+	//finish writing; call before drawing:
+	void unmap();
+
+	//bind block 'i' at ObjectBlockBinding:
+	void bind(uint32_t i) const;
+
+	uint32_t count = 0;
+	GLintptr offset = 0; //of block zero in the ring buffer
+	GLsizeiptr stride = 0; //sizeof(ObjectBlock) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	char *mapped = nullptr;
+};
@@ -0,0 +1,234 @@
+//battle-sim runs many battles between the game's characters (no window, no sound)
+// and reports win rates and damage distributions, for balancing moves.
+
+#include "Battle.hpp"
+#include "BattleData.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <random>
+#include <thread>
+#include <vector>
+
+//counts from a batch of battles (one per thread, merged at the end):
+struct Tally {
+	static constexpr uint32_t MaxTurnBin = 64; //battles lasting this long or longer share the last bin
+	static constexpr uint32_t MaxDamageBin = 64; //hits doing this much or more share the last bin
+
+	std::array< uint64_t, 4 > outcomes{}; //indexed by TurnResult::Outcome
+	uint64_t turns = 0;
+	std::array< uint64_t, MaxTurnBin + 1 > turn_histogram{};
+
+	struct MoveStats {
+		uint64_t uses = 0, hits = 0, crits = 0, damage = 0, healed = 0;
+		std::array< uint64_t, MaxDamageBin + 1 > damage_histogram{};
+	};
+	std::array< std::vector< MoveStats >, 2 > moves; //per combatant, per move
+
+	Tally(Combatant const &a, Combatant const &b) {
+		moves[0].resize(a.move_count);
+		moves[1].resize(b.move_count);
+	}
+
+	void add(Tally const &o) {
+		for (uint32_t i = 0; i < outcomes.size(); ++i) outcomes[i] += o.outcomes[i];
+		turns += o.turns;
+		for (uint32_t i = 0; i < turn_histogram.size(); ++i) turn_histogram[i] += o.turn_histogram[i];
+		for (uint32_t c = 0; c < 2; ++c) {
+			for (uint32_t m = 0; m < moves[c].size(); ++m) {
+				MoveStats &s = moves[c][m];
+				MoveStats const &os = o.moves[c][m];
+				s.uses += os.uses;
+				s.hits += os.hits;
+				s.crits += os.crits;
+				s.damage += os.damage;
+				s.healed += os.healed;
+				for (uint32_t i = 0; i < s.damage_histogram.size(); ++i) s.damage_histogram[i] += os.damage_histogram[i];
+			}
+		}
+	}
+};
+
+//compare roll throughput of the old per-call std::mt19937 approach with Random:
+static void benchmark_rng() {
+	std::cout << "Rolls per second (uniform floats in [0,1)):\n";
+	auto run = [](char const *label, uint64_t rolls, std::function< double() > const &body) {
+		auto before = std::chrono::high_resolution_clock::now();
+		double sink = body(); //(summed rolls, so the work can't be optimized out)
+		float seconds = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - before).count();
+		std::cout << "  " << std::left << std::setw(44) << label << std::right << std::setw(14) << std::fixed << std::setprecision(0)
+		          << double(rolls) / std::max(1e-6, double(seconds)) << "  (sum " << std::setprecision(1) << sink << ")\n";
+	};
+
+	constexpr uint64_t Few = 200000; //the old approach is slow enough that fewer rolls suffice
+	constexpr uint64_t Many = 100000000;
+
+	run("std::mt19937 seeded from time, per roll (old)", Few, [&](){
+		double sum = 0.0;
+		for (uint64_t i = 0; i < Few; ++i) {
+			std::mt19937 mt(uint32_t(std::time(nullptr)));
+			sum += float(mt()) / float(mt.max());
+		}
+		return sum;
+	});
+	run("std::mt19937, reused", Many, [&](){
+		std::mt19937 mt(1);
+		double sum = 0.0;
+		for (uint64_t i = 0; i < Many; ++i) sum += float(mt() >> 8) * (1.0f / float(1 << 24));
+		return sum;
+	});
+	run("Random::next_float", Many, [&](){
+		Random rng(1);
+		double sum = 0.0;
+		for (uint64_t i = 0; i < Many; ++i) sum += rng.next_float();
+		return sum;
+	});
+	run("Random::fill_floats (batches of 256)", Many, [&](){
+		Random rng(1);
+		float batch[256];
+		double sum = 0.0;
+		for (uint64_t i = 0; i < Many; i += 256) {
+			rng.fill_floats(batch, 256);
+			for (float f : batch) sum += f;
+		}
+		return sum;
+	});
+	std::cout.flush();
+}
+
+int main(int argc, char **argv) {
+	uint64_t battles = 1000000;
+	uint32_t threads = std::max(1U, std::thread::hardware_concurrency());
+	uint64_t seed = 0x5eed;
+	uint32_t max_turns = 1000;
+	Policy policies[2];
+	std::string data_file = "dist/characters.battle";
+	std::string names[2] = { "Toast", "Bread" };
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--bench-rng") {
+				benchmark_rng();
+				return 0;
+			}
+			if (i + 1 >= argc) throw std::runtime_error("Expecting a value after '" + arg + "'.");
+			std::string value = argv[i+1];
+			i += 1;
+			if (arg == "--battles") battles = std::stoull(value);
+			else if (arg == "--threads") threads = std::max(1U, uint32_t(std::stoul(value)));
+			else if (arg == "--seed") seed = std::stoull(value);
+			else if (arg == "--max-turns") max_turns = std::max(1U, uint32_t(std::stoul(value)));
+			else if (arg == "--p1") policies[0] = Policy::parse(value);
+			else if (arg == "--p2") policies[1] = Policy::parse(value);
+			else if (arg == "--data") data_file = value;
+			else if (arg == "--c1") names[0] = value;
+			else if (arg == "--c2") names[1] = value;
+			else throw std::runtime_error("Unknown option '" + arg + "'.");
+		}
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " [--battles N] [--threads T] [--seed S] [--max-turns N] [--p1 POLICY] [--p2 POLICY]\n"
+		          << "\t\t[--data characters.battle] [--c1 CHARACTER] [--c2 CHARACTER]\n"
+		          << "\t" << argv[0] << " --bench-rng\n"
+		          << "\t(POLICY is 'random', 'greedy', or 'script:i,j,...')" << std::endl;
+		return 1;
+	}
+
+	//(loaded before the timer starts, since it is a single map of the file)
+	std::unique_ptr< BattleData > data;
+	Combatant fighters[2];
+	try {
+		data.reset(new BattleData(data_file));
+		fighters[0] = data->lookup(names[0]);
+		fighters[1] = data->lookup(names[1]);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	//each thread runs a slice of the battles with its own generators and tally:
+	std::vector< Tally > tallies(threads, Tally(fighters[0], fighters[1]));
+	std::vector< std::thread > workers;
+	for (uint32_t t = 0; t < threads; ++t) {
+		uint64_t begin = battles * t / threads;
+		uint64_t end = battles * (t + 1) / threads;
+		workers.emplace_back([&, t, begin, end](){
+			//(one stream per thread per combatant, so results depend only on seed and thread count)
+			Random rng_a(seed, 2 * t + 0);
+			Random rng_b(seed, 2 * t + 1);
+			Tally &tally = tallies[t];
+			for (uint64_t b = begin; b < end; ++b) {
+				BattleResult result = run_battle(fighters[0], policies[0], rng_a, fighters[1], policies[1], rng_b, max_turns,
+					[&tally](uint32_t who, uint32_t move, MoveResult const &r) {
+						Tally::MoveStats &s = tally.moves[who][move];
+						s.uses += 1;
+						s.hits += r.hit;
+						s.crits += r.crit;
+						s.damage += uint64_t(r.damage);
+						s.healed += uint64_t(r.healed);
+						if (r.hit && r.damage > 0) s.damage_histogram[std::min(uint32_t(r.damage), Tally::MaxDamageBin)] += 1;
+					}
+				);
+				tally.outcomes[result.outcome] += 1;
+				tally.turns += result.turns;
+				tally.turn_histogram[std::min(result.turns, Tally::MaxTurnBin)] += 1;
+			}
+		});
+	}
+	for (auto &w : workers) w.join();
+
+	Tally total(fighters[0], fighters[1]);
+	for (auto const &t : tallies) total.add(t);
+
+	float seconds = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - before).count();
+
+	//------ report ------
+	auto percent = [](uint64_t n, uint64_t d) { return (d ? 100.0 * double(n) / double(d) : 0.0); };
+
+	std::cout << battles << " battles on " << threads << " threads in " << std::fixed << std::setprecision(2) << seconds << "s ("
+	          << std::setprecision(0) << double(battles) / std::max(1e-6, double(seconds)) << " battles/s)\n";
+	std::cout << std::setprecision(2);
+	std::cout << "  player 1 wins: " << percent(total.outcomes[TurnResult::AWins], battles) << "%\n";
+	std::cout << "  player 2 wins: " << percent(total.outcomes[TurnResult::BWins], battles) << "%\n";
+	std::cout << "  draws: " << percent(total.outcomes[TurnResult::Draw], battles) << "%\n";
+	std::cout << "  mean turns: " << (battles ? double(total.turns) / double(battles) : 0.0) << "\n";
+
+	std::cout << "  battle length (turns: % of battles):";
+	for (uint32_t i = 0; i < total.turn_histogram.size(); ++i) {
+		if (total.turn_histogram[i] == 0) continue;
+		std::cout << " " << i << (i == Tally::MaxTurnBin ? "+" : "") << ":" << percent(total.turn_histogram[i], battles);
+	}
+	std::cout << "\n";
+
+	for (uint32_t c = 0; c < 2; ++c) {
+		for (uint32_t m = 0; m < fighters[c].move_count; ++m) {
+			Tally::MoveStats const &s = total.moves[c][m];
+			std::cout << "  player " << (c + 1) << " " << fighters[c].name << " '" << fighters[c].moves[m].name << "': "
+			          << s.uses << " uses, " << percent(s.hits, s.uses) << "% hit, " << percent(s.crits, s.hits) << "% crit, "
+			          << "mean damage per hit " << (s.hits ? double(s.damage) / double(s.hits) : 0.0);
+			if (s.healed) std::cout << ", mean heal per hit " << double(s.healed) / double(s.hits);
+			std::cout << "\n";
+			std::cout << "    damage (amount: % of hits):";
+			for (uint32_t i = 0; i < s.damage_histogram.size(); ++i) {
+				if (s.damage_histogram[i] == 0) continue;
+				std::cout << " " << i << (i == Tally::MaxDamageBin ? "+" : "") << ":" << percent(s.damage_histogram[i], s.hits);
+			}
+			std::cout << "\n";
+		}
+	}
+	std::cout.flush();
+
+	return 0;
+}
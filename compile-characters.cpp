@@ -0,0 +1,138 @@
+//compile-characters turns a text file of move and character definitions
+// (see scenes/characters.txt for the syntax) into the chunk format loaded by BattleData.
+
+#include "BattleData.hpp"
+#include "read_write_chunk.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <characters.txt> <characters.battle>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = argv[1];
+	std::string out_filename = argv[2];
+
+	std::vector< BattleData::CharacterEntry > characters;
+	std::vector< BattleData::MoveEntry > moves;
+	std::vector< char > strings;
+
+	auto add_string = [&strings](std::string const &str, uint32_t *begin, uint32_t *end) {
+		*begin = uint32_t(strings.size());
+		strings.insert(strings.end(), str.begin(), str.end());
+		*end = uint32_t(strings.size());
+	};
+
+	try {
+		std::ifstream in(in_filename, std::ios::binary);
+		if (!in) throw std::runtime_error("Failed to open '" + in_filename + "'.");
+
+		uint32_t line_number = 0;
+		std::string line;
+		while (std::getline(in, line)) {
+			line_number += 1;
+			auto error = [&](std::string const &message) {
+				return std::runtime_error(in_filename + ":" + std::to_string(line_number) + ": " + message);
+			};
+
+			//strip comments and surrounding whitespace:
+			line = line.substr(0, line.find('#'));
+			size_t first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos) continue;
+			line = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+
+			//split into keyword and value:
+			size_t split = line.find_first_of(" \t");
+			if (split == std::string::npos) throw error("Expecting a value after '" + line + "'.");
+			std::string keyword = line.substr(0, split);
+			std::string value = line.substr(line.find_first_not_of(" \t", split));
+
+			auto to_float = [&]() {
+				size_t used = 0;
+				float f = 0.0f;
+				try { f = std::stof(value, &used); } catch (std::exception &) { }
+				if (used == 0 || used != value.size()) throw error("Expecting a number for '" + keyword + "', got '" + value + "'.");
+				return f;
+			};
+			auto to_probability = [&]() {
+				float f = to_float();
+				if (!(f >= 0.0f && f <= 1.0f)) throw error("Expecting a probability (0 to 1) for '" + keyword + "', got '" + value + "'.");
+				return f;
+			};
+			auto to_uint = [&]() {
+				if (value.find_first_not_of("0123456789") != std::string::npos) throw error("Expecting a whole number for '" + keyword + "', got '" + value + "'.");
+				return uint32_t(std::stoul(value));
+			};
+
+			if (keyword == "character") {
+				BattleData::CharacterEntry character;
+				add_string(value, &character.name_begin, &character.name_end);
+				character.max_health = Combatant::DefaultMaxHealth;
+				character.move_begin = character.move_end = uint32_t(moves.size());
+				characters.emplace_back(character);
+			} else if (characters.empty()) {
+				throw error("Expecting 'character' before '" + keyword + "'.");
+			} else if (keyword == "max_health") {
+				characters.back().max_health = int32_t(to_uint());
+			} else if (keyword == "move") {
+				Move defaults;
+				BattleData::MoveEntry move;
+				add_string(value, &move.name_begin, &move.name_end);
+				move.kind = defaults.kind;
+				move.accuracy = defaults.accuracy;
+				move.base_damage = defaults.base_damage;
+				move.crit_chance = defaults.crit_chance;
+				move.percent_heal = defaults.percent_heal;
+				moves.emplace_back(move);
+				characters.back().move_end = uint32_t(moves.size());
+			} else if (characters.back().move_begin == characters.back().move_end) {
+				throw error("Expecting 'move' before '" + keyword + "'.");
+			} else if (keyword == "effect") {
+				uint32_t kind = 0;
+				while (kind < Move::KindCount && value != move_kind_names[kind]) ++kind;
+				if (kind == Move::KindCount) throw error("Unknown effect '" + value + "'.");
+				moves.back().kind = kind;
+			} else if (keyword == "accuracy") {
+				moves.back().accuracy = to_probability();
+			} else if (keyword == "base_damage") {
+				moves.back().base_damage = to_uint();
+			} else if (keyword == "crit_chance") {
+				moves.back().crit_chance = to_probability();
+			} else if (keyword == "percent_heal") {
+				moves.back().percent_heal = to_float();
+			} else {
+				throw error("Unknown keyword '" + keyword + "'.");
+			}
+		}
+
+		for (auto const &character : characters) {
+			if (character.move_begin == character.move_end) {
+				throw std::runtime_error(in_filename + ": character '"
+					+ std::string(strings.data() + character.name_begin, strings.data() + character.name_end) + "' has no moves.");
+			}
+		}
+
+		std::ofstream out(out_filename, std::ios::binary);
+		ChunkWriter writer(out);
+		writer.write("chr0", characters);
+		writer.write("mov0", moves);
+		writer.write("str0", strings);
+		writer.finish();
+		if (!out) throw std::runtime_error("Failed to write '" + out_filename + "'.");
+		out.close();
+
+		//check the result loads:
+		BattleData data(out_filename);
+		std::cout << "Wrote " << data.characters.size() << " characters with " << data.moves.size() << " moves to '" << out_filename << "'." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+//convert-scene rewrites a version 1 scene file (from export-scene.py) as version 2 (see SceneFile.hpp):
+// names are interned and hashed, mesh entries refer to names by index, and transforms
+// are stored parents-first, so loading needs no parsing.
+
+#include "SceneFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//version 1 records:
+struct HierarchyEntry {
+	uint32_t parent;
+	uint32_t name_begin;
+	uint32_t name_end;
+	float position[3];
+	float rotation[4]; //x,y,z,w
+	float scale[3];
+};
+static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+struct MeshEntry {
+	uint32_t transform;
+	uint32_t name_begin;
+	uint32_t name_end;
+};
+static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <in.scene> <out.scene>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = argv[1];
+	std::string out_filename = argv[2];
+
+	try {
+		if (SceneFile::is_v2(in_filename)) {
+			throw std::runtime_error("'" + in_filename + "' is already a version 2 scene.");
+		}
+
+		MappedFile in(in_filename);
+		ChunkReader chunks(in);
+
+		std::vector< char > strings;
+		std::vector< HierarchyEntry > hierarchy;
+		std::vector< MeshEntry > meshes;
+		std::vector< SceneFile::CameraEntry > cameras;
+		std::vector< SceneFile::LightEntry > lights;
+		chunks.read(chunks.get("str0"), &strings);
+		chunks.read(chunks.get("xfh0"), &hierarchy);
+		chunks.read(chunks.get("msh0"), &meshes);
+		chunks.read(chunks.get("cam0"), &cameras);
+		ChunkReader::Chunk const *lmp0 = &chunks.get("lmp0");
+		chunks.read(*lmp0, &lights);
+
+		//extra chunks (those after lmp0) are copied as-is; str0 and transform order don't change, so their references stay good:
+		std::vector< ChunkReader::Chunk const * > extra;
+		for (auto const &chunk : chunks.chunks) {
+			if (&chunk > lmp0) extra.emplace_back(&chunk);
+		}
+
+		//intern names (each distinct name keeps the range of its first use):
+		std::vector< SceneFile::NameEntry > names;
+		std::unordered_map< std::string, uint32_t > name_to_index;
+		auto intern = [&](uint32_t begin, uint32_t end) {
+			if (!(begin <= end && end <= strings.size())) {
+				throw std::runtime_error("scene file '" + in_filename + "' contains an entry with invalid name indices");
+			}
+			std::string text(strings.begin() + begin, strings.begin() + end);
+			auto ret = name_to_index.emplace(text, uint32_t(names.size()));
+			if (ret.second) names.emplace_back(SceneFile::NameEntry{hash_name(text), begin, end});
+			return ret.first->second;
+		};
+		std::vector< uint32_t > transform_names, mesh_names;
+		for (auto const &h : hierarchy) transform_names.emplace_back(intern(h.name_begin, h.name_end));
+		for (auto const &m : meshes) mesh_names.emplace_back(intern(m.name_begin, m.name_end));
+
+		//sort names by hash (for SceneFile::find_name) and renumber references:
+		std::vector< uint32_t > order(names.size());
+		for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return names[a].hash < names[b].hash; });
+		std::vector< uint32_t > renumber(names.size());
+		std::vector< SceneFile::NameEntry > sorted_names;
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			renumber[order[i]] = i;
+			sorted_names.emplace_back(names[order[i]]);
+		}
+
+		//transforms (parents always come first):
+		std::vector< SceneFile::TransformEntry > transforms;
+		transforms.reserve(hierarchy.size());
+		for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+			HierarchyEntry const &h = hierarchy[i];
+			if (h.parent != -1U && h.parent >= i) {
+				throw std::runtime_error("scene file '" + in_filename + "' did not contain transforms in topological-sort order.");
+			}
+			SceneFile::TransformEntry t;
+			t.parent = h.parent;
+			t.name = renumber[transform_names[i]];
+			std::copy(h.position, h.position + 3, t.position);
+			std::copy(h.rotation, h.rotation + 4, t.rotation);
+			std::copy(h.scale, h.scale + 3, t.scale);
+			transforms.emplace_back(t);
+		}
+
+		std::vector< SceneFile::MeshEntry > mesh_entries;
+		for (uint32_t i = 0; i < meshes.size(); ++i) {
+			if (meshes[i].transform >= hierarchy.size()) {
+				throw std::runtime_error("scene file '" + in_filename + "' contains mesh entry with invalid transform index (" + std::to_string(meshes[i].transform) + ")");
+			}
+			mesh_entries.emplace_back(SceneFile::MeshEntry{meshes[i].transform, renumber[mesh_names[i]]});
+		}
+
+		{
+			std::ofstream out(out_filename, std::ios::binary);
+			ChunkWriter writer(out);
+			writer.write("xfh3", transforms);
+			writer.write("nam2", sorted_names);
+			writer.write("msh2", mesh_entries);
+			writer.write("cam0", cameras);
+			writer.write("lmp0", lights);
+			writer.write("str0", strings);
+			for (ChunkReader::Chunk const *chunk : extra) {
+				writer.write(chunk->tag(), chunk->data, chunk->size);
+			}
+			writer.finish();
+			if (!out) throw std::runtime_error("Failed to write '" + out_filename + "'.");
+		}
+
+		//read it back, to be sure it loads:
+		SceneFile check(out_filename);
+
+		std::cout << "Wrote " << check.transform_count << " transforms, " << check.mesh_count << " meshes, "
+			<< check.camera_count << " cameras, and " << check.light_count << " lights ("
+			<< check.name_count << " distinct names) to '" << out_filename << "'." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
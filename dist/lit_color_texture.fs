@@ -0,0 +1,114 @@
+#version 330
+uniform sampler2D TEX;
+uniform samplerBuffer LIGHTS; //4 texels per light: (location, type), (direction, cutoff), (energy, range), (first shadow layer, shadow layer count)
+uniform usamplerBuffer CLUSTERS; //per cluster: (first index, count)
+uniform usamplerBuffer LIGHT_INDICES;
+uniform sampler2DArrayShadow SHADOW;
+layout(std140) uniform Frame {
+	mat4 WORLD_TO_CLIP;
+	mat4 WORLD_TO_LIGHT;
+	vec4 LIGHT_LOCATION_;
+	vec4 LIGHT_DIRECTION_;
+	vec4 LIGHT_ENERGY_;
+	int LIGHT_TYPE;
+	float LIGHT_CUTOFF;
+	mat4 WORLD_TO_VIEW;
+	vec4 CLUSTER_SCALE;
+	ivec4 CLUSTER_COUNT;
+	mat4 WORLD_TO_SHADOW[8];
+	vec4 CASCADE_SPLITS;
+};
+in vec3 position;
+in vec3 normal;
+in vec4 color;
+in vec2 texCoord;
+out vec4 fragColor;
+
+float view_depth; //(set at the start of main)
+
+//fraction of light reaching 'position' through the given shadow map layers:
+// (more than one layer means cascades, chosen by view depth)
+float shadow(int first, int count) {
+	int layer = first;
+	if (count > 1) {
+		int cascade = int(dot(step(CASCADE_SPLITS, vec4(view_depth)), vec4(1.0)));
+		if (cascade >= count) return 1.0; //past the last cascade
+		layer += cascade;
+	}
+	vec4 at = WORLD_TO_SHADOW[layer] * vec4(position, 1.0);
+	vec3 stz = at.xyz / at.w;
+	if (any(lessThan(stz, vec3(0.0))) || any(greaterThan(stz, vec3(1.0)))) return 1.0;
+	//3x3 PCF (each tap is itself a filtered 2x2 comparison):
+	vec2 texel = 1.0 / vec2(textureSize(SHADOW, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			lit += texture(SHADOW, vec4(stz.xy + vec2(x, y) * texel, float(layer), stz.z));
+		}
+	}
+	return lit / 9.0;
+}
+
+//light reaching a surface at 'position' with normal 'n':
+// (range > 0 fades point and spot lights smoothly to zero at that distance)
+vec3 shade(int type, vec3 location, vec3 direction, vec3 energy, float cutoff, float range, vec3 n) {
+	if (type == 0) { //point light
+		vec3 l = (location - position);
+		float dis2 = dot(l,l);
+		l = normalize(l);
+		float nl = max(0.0, dot(n, l)) / max(1.0, dis2);
+		if (range > 0.0) nl *= pow(clamp(1.0 - pow(dis2 / (range * range), 2.0), 0.0, 1.0), 2.0);
+		return nl * energy;
+	} else if (type == 1) { //hemi light
+		return (dot(n,-direction) * 0.5 + 0.5) * energy;
+	} else if (type == 2) { //spot light
+		vec3 l = (location - position);
+		float dis2 = dot(l,l);
+		l = normalize(l);
+		float nl = max(0.0, dot(n, l)) / max(1.0, dis2);
+		float c = dot(l,-direction);
+		nl *= smoothstep(cutoff,mix(cutoff,1.0,0.1), c);
+		if (range > 0.0) nl *= pow(clamp(1.0 - pow(dis2 / (range * range), 2.0), 0.0, 1.0), 2.0);
+		return nl * energy;
+	} else { //(type == 3) //directional light
+		return max(0.0, dot(n,-direction)) * energy;
+	}
+}
+
+vec3 shade_listed(int index, vec3 n) {
+	vec4 location_type = texelFetch(LIGHTS, 4 * index + 0);
+	vec4 direction_cutoff = texelFetch(LIGHTS, 4 * index + 1);
+	vec4 energy_range = texelFetch(LIGHTS, 4 * index + 2);
+	vec4 shadow_layers = texelFetch(LIGHTS, 4 * index + 3);
+	vec3 e = shade(int(location_type.w), location_type.xyz, direction_cutoff.xyz, energy_range.rgb, direction_cutoff.w, energy_range.w, n);
+	if (shadow_layers.y > 0.0 && e != vec3(0.0)) {
+		e *= shadow(int(shadow_layers.x), int(shadow_layers.y));
+	}
+	return e;
+}
+
+void main() {
+	view_depth = -(WORLD_TO_VIEW * vec4(position, 1.0)).z;
+	vec3 n = normalize(normal);
+	vec3 e = vec3(0.0);
+	if (LIGHT_TYPE >= 0) {
+		e += shade(LIGHT_TYPE, LIGHT_LOCATION_.xyz, LIGHT_DIRECTION_.xyz, LIGHT_ENERGY_.xyz, LIGHT_CUTOFF, 0.0, n);
+	}
+	if (CLUSTER_COUNT.z > 0) {
+		//lights that reach everywhere:
+		for (int i = 0; i < CLUSTER_COUNT.w; ++i) {
+			e += shade_listed(i, n);
+		}
+		//lights binned into this fragment's cluster:
+		ivec3 cluster = ivec3(
+			min(ivec2(gl_FragCoord.xy * CLUSTER_SCALE.xy), CLUSTER_COUNT.xy - 1),
+			clamp(int(floor(log(max(view_depth, 1e-6)) * CLUSTER_SCALE.z + CLUSTER_SCALE.w)), 0, CLUSTER_COUNT.z - 1)
+		);
+		uvec2 range = texelFetch(CLUSTERS, (cluster.z * CLUSTER_COUNT.y + cluster.y) * CLUSTER_COUNT.x + cluster.x).xy;
+		for (uint k = 0u; k < range.y; ++k) {
+			e += shade_listed(int(texelFetch(LIGHT_INDICES, int(range.x + k)).x), n);
+		}
+	}
+	vec4 albedo = texture(TEX, texCoord) * color;
+	fragColor = vec4(e*albedo.rgb, albedo.a);
+}
@@ -0,0 +1,22 @@
+#version 330
+layout(std140) uniform Object {
+	mat4 OBJECT_TO_CLIP;
+	mat4 OBJECT_TO_LIGHT;
+	mat3 NORMAL_TO_LIGHT;
+};
+layout(location = 0) in vec4 Position; //(at 0 so depth passes can share vertex arrays; see DepthProgram.hpp)
+in vec3 Normal;
+in vec4 Color;
+in vec2 TexCoord;
+out vec3 position;
+out vec3 normal;
+out vec4 color;
+out vec2 texCoord;
+invariant gl_Position; //(must match DepthProgram exactly for depth pre-pass + GL_EQUAL)
+void main() {
+	gl_Position = OBJECT_TO_CLIP * Position;
+	position = (OBJECT_TO_LIGHT * Position).xyz;
+	normal = NORMAL_TO_LIGHT * Normal;
+	color = Color;
+	texCoord = TexCoord;
+}
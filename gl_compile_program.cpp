@@ -1,10 +1,171 @@
 #include "gl_compile_program.hpp"
 
+#include <SDL.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <iostream>
 
+//Program binaries are core in GL 4.1 (and in ARB_get_program_binary), so aren't in GL.hpp.
+// They are declared the same way GL.hpp declares entry points; support is checked at runtime.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+#endif
+#ifdef _WIN32
+static void (APIENTRYFP glGetProgramBinary) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = nullptr;
+static void (APIENTRYFP glProgramBinary) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = nullptr;
+static void (APIENTRYFP glProgramParameteri) (GLuint program, GLenum pname, GLint value) = nullptr;
+#else
+extern "C" {
+GLAPI void APIENTRY glGetProgramBinary (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+GLAPI void APIENTRY glProgramBinary (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+GLAPI void APIENTRY glProgramParameteri (GLuint program, GLenum pname, GLint value);
+}
+#endif
+
+namespace {
+	//64-bit FNV-1a, for keying programs by source:
+	uint64_t hash_bytes(char const *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= uint8_t(data[i]);
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	uint64_t hash_source(std::string const &vertex_shader_source, std::string const &fragment_shader_source) {
+		uint64_t hash = hash_bytes(vertex_shader_source.data(), vertex_shader_source.size());
+		hash = hash_bytes("", 1, hash); //(separator, so moving text between the two sources changes the hash)
+		return hash_bytes(fragment_shader_source.data(), fragment_shader_source.size(), hash);
+	}
+
+	struct CachedProgram {
+		uint64_t source_hash = 0;
+		uint32_t references = 0;
+	};
+	std::map< uint64_t, GLuint > &programs_by_source() {
+		static std::map< uint64_t, GLuint > map;
+		return map;
+	}
+	std::map< GLuint, CachedProgram > &cached_programs() {
+		static std::map< GLuint, CachedProgram > map;
+		return map;
+	}
+	std::map< std::pair< GLuint, std::string >, GLint > &uniform_locations() {
+		static std::map< std::pair< GLuint, std::string >, GLint > map;
+		return map;
+	}
+	std::map< std::pair< GLuint, std::string >, GLint > &attrib_locations() {
+		static std::map< std::pair< GLuint, std::string >, GLint > map;
+		return map;
+	}
+	void forget_locations(GLuint program) {
+		for (auto *map : {&uniform_locations(), &attrib_locations()}) {
+			map->erase(map->lower_bound(std::make_pair(program, std::string())), map->lower_bound(std::make_pair(program + 1, std::string())));
+		}
+	}
+
+	//binaries are only valid for the driver that made them:
+	uint64_t driver_hash() {
+		static uint64_t hash = 0;
+		if (hash == 0) {
+			hash = 0xcbf29ce484222325ULL;
+			for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+				char const *str = reinterpret_cast< char const * >(glGetString(name));
+				if (str) hash = hash_bytes(str, std::strlen(str) + 1, hash);
+			}
+		}
+		return hash;
+	}
+
+	bool binaries_supported() {
+		static int supported = -1;
+		if (supported == -1) {
+			#ifdef _WIN32
+			glGetProgramBinary = (decltype(glGetProgramBinary))SDL_GL_GetProcAddress("glGetProgramBinary");
+			glProgramBinary = (decltype(glProgramBinary))SDL_GL_GetProcAddress("glProgramBinary");
+			glProgramParameteri = (decltype(glProgramParameteri))SDL_GL_GetProcAddress("glProgramParameteri");
+			if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri) {
+				supported = 0;
+				return false;
+			}
+			#endif
+			while (glGetError() != GL_NO_ERROR) { } //(clear any earlier errors)
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			supported = (glGetError() == GL_NO_ERROR && formats > 0) ? 1 : 0;
+		}
+		return supported == 1;
+	}
+
+	//on-disk binary: header, then the driver's binary blob:
+	struct BinaryHeader {
+		char magic[4] = {'g', 'l', 'p', 'b'};
+		uint32_t format = 0; //binaryFormat from glGetProgramBinary
+		uint64_t driver_hash = 0;
+		uint64_t source_hash = 0;
+	};
+	static_assert(sizeof(BinaryHeader) == 24, "BinaryHeader is packed");
+
+	std::string binary_path(uint64_t source_hash) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)source_hash);
+		return gl_program_cache_directory + "/" + name;
+	}
+
+	//returns 0 if there's no usable binary:
+	GLuint load_binary(uint64_t source_hash) {
+		std::ifstream file(binary_path(source_hash), std::ios::binary);
+		if (!file) return 0;
+		BinaryHeader header, expected;
+		if (!file.read(reinterpret_cast< char * >(&header), sizeof(header))) return 0;
+		if (std::memcmp(header.magic, expected.magic, 4) != 0
+		 || header.driver_hash != driver_hash()
+		 || header.source_hash != source_hash) return 0;
+		std::vector< char > blob((std::istreambuf_iterator< char >(file)), std::istreambuf_iterator< char >());
+		if (blob.empty()) return 0;
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header.format, blob.data(), GLsizei(blob.size()));
+		GLint link_status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+		if (link_status != GL_TRUE) { //(e.g., driver updated in a way that didn't change its strings)
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	void save_binary(GLuint program, uint64_t source_hash) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+		std::vector< char > blob(length);
+		BinaryHeader header;
+		header.driver_hash = driver_hash();
+		header.source_hash = source_hash;
+		GLsizei written = 0;
+		glGetProgramBinary(program, length, &written, &header.format, blob.data());
+		if (written <= 0) return;
+
+		std::error_code ec;
+		std::filesystem::create_directories(gl_program_cache_directory, ec);
+		std::ofstream file(binary_path(source_hash), std::ios::binary);
+		file.write(reinterpret_cast< char const * >(&header), sizeof(header));
+		file.write(blob.data(), written);
+		if (!file) std::cerr << "WARNING: failed to save program binary to '" << binary_path(source_hash) << "'." << std::endl;
+	}
+}
+
 static GLuint gl_compile_shader(GLenum type, std::string const &source) {
 	GLuint shader = glCreateShader(type);
 	GLchar const *str = source.c_str();
@@ -27,9 +188,11 @@ static GLuint gl_compile_shader(GLenum type, std::string const &source) {
 	return shader;
 }
 
-GLuint gl_compile_program(
+//compile and link from source (without any caching):
+static GLuint link_program(
 	std::string const &vertex_shader_source,
-	std::string const &fragment_shader_source
+	std::string const &fragment_shader_source,
+	bool retrievable
 	) {
 
 	GLuint vertex_shader = gl_compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
@@ -43,6 +206,9 @@ GLuint gl_compile_program(
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
+	//ask to be able to save the linked program:
+	if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	//link the shader program and throw errors if linking fails:
 	glLinkProgram(program);
 	GLint link_status = GL_FALSE;
@@ -55,8 +221,131 @@ GLuint gl_compile_program(
 		GLsizei length = 0;
 		glGetProgramInfoLog(program, GLint(info_log.size()), &length, &info_log[0]);
 		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		glDeleteProgram(program);
 		throw std::runtime_error("failed to link program");
 	}
 
 	return program;
 }
+
+GLuint gl_compile_program(
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source
+	) {
+
+	uint64_t source_hash = hash_source(vertex_shader_source, fragment_shader_source);
+
+	//already made this program?
+	auto f = programs_by_source().find(source_hash);
+	if (f != programs_by_source().end()) {
+		cached_programs()[f->second].references += 1;
+		return f->second;
+	}
+
+	bool use_binaries = !gl_program_cache_directory.empty() && binaries_supported();
+
+	GLuint program = (use_binaries ? load_binary(source_hash) : 0);
+	if (program == 0) {
+		program = link_program(vertex_shader_source, fragment_shader_source, use_binaries);
+		if (use_binaries) save_binary(program, source_hash);
+	}
+
+	programs_by_source()[source_hash] = program;
+	CachedProgram &cached = cached_programs()[program];
+	cached.source_hash = source_hash;
+	cached.references = 1;
+
+	return program;
+}
+
+void gl_release_program(GLuint program) {
+	auto f = cached_programs().find(program);
+	if (f == cached_programs().end()) {
+		//(not from gl_compile_program)
+		glDeleteProgram(program);
+		return;
+	}
+	assert(f->second.references > 0);
+	f->second.references -= 1;
+	if (f->second.references > 0) return;
+
+	auto s = programs_by_source().find(f->second.source_hash);
+	if (s != programs_by_source().end() && s->second == program) programs_by_source().erase(s);
+	cached_programs().erase(f);
+	forget_locations(program);
+	glDeleteProgram(program);
+}
+
+GLint gl_uniform_location(GLuint program, std::string const &name) {
+	auto key = std::make_pair(program, name);
+	auto f = uniform_locations().find(key);
+	if (f == uniform_locations().end()) {
+		f = uniform_locations().emplace(key, glGetUniformLocation(program, name.c_str())).first;
+	}
+	return f->second;
+}
+
+GLint gl_attrib_location(GLuint program, std::string const &name) {
+	auto key = std::make_pair(program, name);
+	auto f = attrib_locations().find(key);
+	if (f == attrib_locations().end()) {
+		f = attrib_locations().emplace(key, glGetAttribLocation(program, name.c_str())).first;
+	}
+	return f->second;
+}
+
+void gl_relink_program(
+	GLuint program,
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source
+	) {
+
+	//check the new source compiles and links in a scratch program first,
+	// since a failed link would leave 'program' unusable:
+	// (not through the cache, since its shaders are moved to 'program' and it is deleted)
+	GLuint scratch = link_program(vertex_shader_source, fragment_shader_source, false);
+
+	//keep attribute locations the same as before:
+	std::vector< std::pair< std::string, GLint > > attribs;
+	GLint active = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
+	for (GLuint i = 0; i < GLuint(active); ++i) {
+		GLchar name[100];
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
+		name[99] = '\0';
+		if (std::string(name).substr(0, 3) == "gl_") continue; //(built-ins can't be bound)
+		attribs.emplace_back(name, glGetAttribLocation(program, name));
+	}
+
+	//swap the scratch program's shaders into 'program':
+	GLuint shaders[8];
+	GLsizei count = 0;
+	glGetAttachedShaders(program, 8, &count, shaders);
+	for (GLsizei i = 0; i < count; ++i) glDetachShader(program, shaders[i]);
+	glGetAttachedShaders(scratch, 8, &count, shaders);
+	for (GLsizei i = 0; i < count; ++i) glAttachShader(program, shaders[i]);
+	glDeleteProgram(scratch); //(shaders stay alive while attached to 'program')
+
+	for (auto const &attrib : attribs) {
+		glBindAttribLocation(program, GLuint(attrib.second), attrib.first.c_str());
+	}
+
+	glLinkProgram(program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		//(shouldn't happen, since the same shaders just linked)
+		throw std::runtime_error("failed to relink program");
+	}
+
+	//the program no longer matches the source it was cached under:
+	auto f = cached_programs().find(program);
+	if (f != cached_programs().end()) {
+		auto s = programs_by_source().find(f->second.source_hash);
+		if (s != programs_by_source().end() && s->second == program) programs_by_source().erase(s);
+		f->second.source_hash = 0;
+	}
+	forget_locations(program);
+}
@@ -6,6 +6,31 @@
 
 //compiles+links an OpenGL shader program from source.
 // throws on compilation error.
+//
+// Programs are cached:
+//  - identical source pairs share one program (so release with gl_release_program, not glDeleteProgram);
+//  - if gl_program_cache_directory is set and the driver supports program binaries,
+//    linked programs are saved there, keyed by a hash of the source and the driver's vendor/renderer/version,
+//    and later runs load the binary instead of compiling (falling back to compiling if it is rejected).
 GLuint gl_compile_program(
 	std::string const &vertex_shader_source,
 	std::string const &fragment_shader_source);
+
+//where to save linked program binaries ("" -- the default -- to not save them):
+// (set before call_load_functions(); e.g., main sets data_path("shader-cache"))
+inline std::string gl_program_cache_directory;
+
+//drop a reference to a program from gl_compile_program; deletes it when nothing else uses it:
+void gl_release_program(GLuint program);
+
+//cached glGetUniformLocation / glGetAttribLocation (for code that looks names up often):
+GLint gl_uniform_location(GLuint program, std::string const &name);
+GLint gl_attrib_location(GLuint program, std::string const &name);
+
+//re-links an existing program from new source, keeping the program name and its attribute locations
+// (so pipelines and VAOs that refer to it stay valid); uniform locations and values must be set again afterward.
+// throws -- leaving 'program' as it was -- on compilation or link error.
+void gl_relink_program(
+	GLuint program,
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//Counters for the GL work issued during a frame.
+// Code that issues draws or uploads uniforms bumps the counts in 'gl_stats';
+// the main loop calls gl_stats_next_frame() once per frame.
+
+struct GLStats {
+	uint32_t draw_calls = 0; //glDraw* calls
+	uint32_t vertices = 0; //vertices submitted by those calls
+	uint32_t uniform_uploads = 0; //glUniform* calls
+	uint32_t state_changes = 0; //program, vertex array, and texture binds
+	uint64_t samples_passed = 0; //fragments passing the depth test inside GLSamplesScopes (only counted while gl_stats_count_samples is set)
+};
+
+//counts for the frame currently being drawn:
+inline GLStats gl_stats;
+
+//counts for the most recently completed frame (useful for on-screen display):
+inline GLStats gl_stats_last_frame;
+
+//count samples in GLSamplesScopes? (reading the counts waits for the GPU, so this is for benchmarks):
+inline bool gl_stats_count_samples = false;
+
+//adds the samples that pass depth testing during its lifetime to gl_stats.samples_passed:
+// (useful for measuring overdraw: samples shaded per pixel)
+struct GLSamplesScope {
+	GLSamplesScope() {
+		if (!gl_stats_count_samples) return;
+		glGenQueries(1, &query);
+		glBeginQuery(GL_SAMPLES_PASSED, query);
+	}
+	~GLSamplesScope() {
+		if (!query) return;
+		glEndQuery(GL_SAMPLES_PASSED);
+		GLuint64 samples = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &samples);
+		glDeleteQueries(1, &query);
+		gl_stats.samples_passed += samples;
+	}
+	GLSamplesScope(GLSamplesScope const &) = delete;
+	GLSamplesScope &operator=(GLSamplesScope const &) = delete;
+
+	GLuint query = 0;
+};
+
+inline void gl_stats_next_frame() {
+	gl_stats_last_frame = gl_stats;
+	gl_stats = GLStats();
+}
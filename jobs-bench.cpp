@@ -0,0 +1,136 @@
+//jobs-bench times the job system (Jobs.hpp):
+//  spawn: cost of running and waiting on empty jobs, from the main thread and from inside jobs
+//  parallel_for: speedup of a fixed amount of arithmetic as workers are added
+//  contention: many tiny jobs spawning more tiny jobs (mostly deque locking and stealing)
+
+#include "Jobs.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//best-of-'trials' seconds that 'fn' takes:
+template< typename Fn >
+static double time_best(uint32_t trials, Fn const &fn) {
+	double best = 1e30;
+	for (uint32_t t = 0; t < trials; ++t) {
+		auto before = std::chrono::high_resolution_clock::now();
+		fn();
+		auto after = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration< double >(after - before).count());
+	}
+	return best;
+}
+
+//some arithmetic the compiler can't skip:
+static float busy_work(uint32_t i) {
+	float x = float(i);
+	for (uint32_t k = 0; k < 64; ++k) x = std::sqrt(x * 1.0001f + 1.0f);
+	return x;
+}
+
+int main(int argc, char **argv) {
+	uint32_t trials = 5;
+	uint32_t max_workers = std::max(1U, std::thread::hardware_concurrency()) - 1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--trials" && i + 1 < argc) {
+			trials = uint32_t(std::max(1, std::atoi(argv[i+1])));
+			i += 1;
+		} else if (arg == "--workers" && i + 1 < argc) {
+			max_workers = uint32_t(std::max(0, std::atoi(argv[i+1])));
+			i += 1;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--trials <n>] [--workers <max>]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	{ //spawn overhead:
+		Jobs::start(max_workers);
+		uint32_t const count = 100000;
+		double from_main = time_best(trials, [&](){
+			Jobs::Counter done;
+			for (uint32_t i = 0; i < count; ++i) Jobs::run([](){}, &done);
+			Jobs::wait(done);
+		});
+		double from_jobs = time_best(trials, [&](){
+			//(each of a few jobs spawns its share, so pushes go to the workers' own deques)
+			uint32_t const spawners = std::max(1U, Jobs::worker_count());
+			Jobs::Counter done;
+			for (uint32_t s = 0; s < spawners; ++s) {
+				Jobs::run([&done, count, spawners](){
+					for (uint32_t i = 0; i < count / spawners; ++i) Jobs::run([](){}, &done);
+				}, &done);
+			}
+			Jobs::wait(done);
+		});
+		double continuations = time_best(trials, [&](){
+			//a chain: each job runs only once the previous has finished
+			uint32_t const length = 10000;
+			std::vector< Jobs::Counter > links(length);
+			Jobs::Counter done;
+			Jobs::run([](){}, &links[0]);
+			for (uint32_t i = 1; i < length; ++i) Jobs::then(links[i-1], [](){}, &links[i]);
+			Jobs::then(links[length-1], [](){}, &done);
+			Jobs::wait(done);
+			for (auto &link : links) Jobs::wait(link);
+		});
+		std::cout << "spawn (" << Jobs::worker_count() << " workers):\n";
+		std::cout << "  from main thread: " << from_main / count * 1e9 << " ns/job\n";
+		std::cout << "  from jobs:        " << from_jobs / count * 1e9 << " ns/job\n";
+		std::cout << "  continuation:     " << continuations / 10000 * 1e9 << " ns/link\n";
+	}
+
+	{ //parallel_for scaling:
+		uint32_t const count = 1 << 20;
+		std::vector< float > out(count);
+		std::cout << "parallel_for (" << count << " items, ~64 sqrt each):\n";
+		//thread counts (workers + the calling thread) in powers of two, then all of them:
+		std::vector< uint32_t > steps;
+		for (uint32_t threads = 1; threads <= max_workers + 1; threads *= 2) steps.emplace_back(threads - 1);
+		if (steps.back() != max_workers) steps.emplace_back(max_workers);
+		double base = 0.0;
+		for (uint32_t workers : steps) {
+			Jobs::start(workers);
+			double seconds = time_best(trials, [&](){
+				Jobs::parallel_for(count, 1024, [&](uint32_t begin, uint32_t end) {
+					for (uint32_t i = begin; i < end; ++i) out[i] = busy_work(i);
+				});
+			});
+			if (workers == 0) base = seconds;
+			std::cout << "  " << std::setw(3) << (workers + 1) << " threads: " << std::setw(8) << seconds * 1e3 << " ms  (" << std::setprecision(2) << base / seconds << "x)" << std::setprecision(1) << "\n";
+		}
+	}
+
+	{ //contention: a tree of tiny jobs, every one spawning more:
+		Jobs::start(max_workers);
+		uint32_t const depth = 16; //2^17 - 1 jobs
+		std::function< void(Jobs::Counter *, uint32_t) > spawn_tree = [&spawn_tree](Jobs::Counter *done, uint32_t level) {
+			if (level == 0) return;
+			Jobs::run([&spawn_tree, done, level](){ spawn_tree(done, level - 1); }, done);
+			Jobs::run([&spawn_tree, done, level](){ spawn_tree(done, level - 1); }, done);
+		};
+		double seconds = time_best(trials, [&](){
+			Jobs::Counter done;
+			spawn_tree(&done, depth);
+			Jobs::wait(done);
+		});
+		double jobs = double((1U << (depth + 1)) - 2);
+		std::cout << "contention (" << uint32_t(jobs) << " jobs in a binary tree, " << Jobs::worker_count() << " workers): " << seconds / jobs * 1e9 << " ns/job\n";
+	}
+
+	std::cout.flush();
+	Jobs::stop();
+	return 0;
+}
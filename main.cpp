@@ -10,6 +10,22 @@
 //For sound init:
 #include "Sound.hpp"
 
+//For per-frame GL counters:
+#include "gl_stats.hpp"
+
+//For frame profiling:
+#include "Profiler.hpp"
+
+//For reloading changed assets:
+#include "HotReload.hpp"
+
+//For saving linked shader programs between runs:
+#include "gl_compile_program.hpp"
+#include "data_path.hpp"
+
+//For benchmarking without a window:
+#include "HeadlessGL.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -25,6 +41,8 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <cstdlib>
+#include <random>
 
 #ifdef _WIN32
 extern "C" { uint32_t GetACP(); }
@@ -45,6 +63,100 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+
+	std::string profile_file; //if non-empty, write a Chrome trace here on exit
+	uint32_t headless_frames = 0; //if non-zero, benchmark this many frames offscreen instead of opening a window
+	uint32_t clone_trials = 0; //if non-zero, time copying the game scene (best of this many trials) instead of playing
+	float tick_rate = 60.0f; //simulation updates per second
+	uint64_t seed = std::random_device{}(); //battle seed (pass the printed value to '--seed' to replay)
+	PlayOptions play_options; //rendering options for benchmarking
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--profile" && i + 1 < argc) {
+			profile_file = argv[i+1];
+			i += 1;
+		} else if (arg == "--headless" && i + 1 < argc) {
+			headless_frames = uint32_t(std::max(1, std::atoi(argv[i+1])));
+			i += 1;
+		} else if (arg == "--clone-bench" && i + 1 < argc) {
+			clone_trials = uint32_t(std::max(1, std::atoi(argv[i+1])));
+			i += 1;
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = std::strtoull(argv[i+1], nullptr, 10);
+			i += 1;
+		} else if (arg == "--lights" && i + 1 < argc) {
+			play_options.extra_lights = uint32_t(std::max(0, std::atoi(argv[i+1])));
+			i += 1;
+		} else if (arg == "--drawables" && i + 1 < argc) {
+			play_options.extra_drawables = uint32_t(std::max(0, std::atoi(argv[i+1])));
+			i += 1;
+		} else if (arg == "--sun") {
+			play_options.sun = true;
+		} else if (arg == "--no-shadow-cache") {
+			play_options.shadow_cache = false;
+		} else if (arg == "--depth-prepass") {
+			play_options.depth_prepass = true;
+		} else if (arg == "--no-lod") {
+			play_options.lod = false;
+		} else if (arg == "--hot-reload") {
+			HotReload::enabled = true;
+		} else if (arg == "--tick-rate" && i + 1 < argc) {
+			tick_rate = float(std::atof(argv[i+1]));
+			if (!(tick_rate > 0.0f)) tick_rate = 60.0f;
+			i += 1;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--profile <trace.json>] [--headless <frames>] [--clone-bench <trials>] [--tick-rate <hz>] [--seed <n>] [--lights <n>] [--drawables <n>] [--sun] [--no-shadow-cache] [--depth-prepass] [--no-lod] [--hot-reload]" << std::endl;
+			return 1;
+		}
+	}
+	if (!profile_file.empty()) {
+		//enabled early so asset loading is captured as well:
+		Profiler::enabled = true;
+	}
+
+	//reuse shader programs linked by previous runs (when the driver supports it):
+	gl_program_cache_directory = data_path("shader-cache");
+
+	//the simulation always advances in steps of exactly one tick:
+	float const tick = 1.0f / tick_rate;
+
+	if (clone_trials) {
+		//------------ scene copy benchmark ------------
+		// (offscreen, since the scene's drawables need loaded meshes and programs; use --drawables and --lights for a larger scene)
+		HeadlessGL headless(glm::uvec2(64, 64));
+
+		call_load_functions();
+
+		benchmark_scene_clone(play_options, seed, clone_trials);
+
+		return 0;
+	}
+
+	if (headless_frames) {
+		//------------ headless benchmark ------------
+		// (no window, no input, no audio device -- just one tick of update + draw per frame, as fast as possible)
+		HeadlessGL headless(glm::uvec2(1280, 720));
+
+		call_load_functions();
+
+		Mode::set_current(std::make_shared< PlayMode >(seed, play_options));
+
+		benchmark_frames(10, headless_frames, [&](){
+			Mode::current->update(tick);
+			//(a whole tick has just been simulated, so draw the state it produced, not the one before it)
+			Mode::current->draw(headless.size, 1.0f);
+		}, headless.size.x * headless.size.y);
+
+		Mode::set_current(nullptr);
+
+		if (!profile_file.empty()) {
+			Profiler::write_chrome_trace(profile_file);
+		}
+
+		return 0;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -111,8 +223,11 @@ int main(int argc, char **argv) {
 	//------------ load assets --------------
 	call_load_functions();
 
+	//watch loaded assets for changes (if --hot-reload was passed):
+	HotReload::start();
+
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< PlayMode >());
+	Mode::set_current(std::make_shared< PlayMode >(seed, play_options));
 
 	//------------ main loop ------------
 
@@ -131,12 +246,19 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//real time not yet simulated, in seconds; always less than one tick after updates:
+	float accumulator = 0.0f;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
+		//swap in any assets that were reloaded since the last frame:
+		HotReload::commit();
+
 		{ //(1) process any events that are pending
+			PROFILE_SCOPE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -168,7 +290,7 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		{ //(2) call the current mode's "update" function once per tick of elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -178,23 +300,42 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			Mode::current->update(elapsed);
+			PROFILE_SCOPE("update");
+			accumulator += elapsed;
+			while (accumulator >= tick) {
+				Mode::current->update(tick);
+				accumulator -= tick;
+				if (!Mode::current) break;
+			}
 			if (!Mode::current) break;
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
-			Mode::current->draw(drawable_size);
+			PROFILE_SCOPE("draw");
+			//draw between the previous and current simulation states:
+			float alpha = std::min(accumulator / tick, 1.0f);
+			Mode::current->draw(drawable_size, alpha);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			PROFILE_SCOPE("swap");
+			SDL_GL_SwapWindow(window);
+		}
+
+		//frame is done; start counting GL work for the next one:
+		gl_stats_next_frame();
+		Profiler::end_frame();
 	}
 
 
 	//------------  teardown ------------
+	HotReload::stop();
 	Sound::shutdown();
 
+	if (!profile_file.empty()) {
+		Profiler::write_chrome_trace(profile_file);
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
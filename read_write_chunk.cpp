@@ -0,0 +1,129 @@
+#include "read_write_chunk.hpp"
+
+#include <array>
+
+uint32_t crc32(void const *data_, size_t size, uint32_t crc) {
+	static std::array< uint32_t, 256 > const table = [](){
+		std::array< uint32_t, 256 > ret;
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (uint32_t k = 0; k < 8; ++k) {
+				c = (c & 1U ? 0xedb88320U ^ (c >> 1) : (c >> 1));
+			}
+			ret[i] = c;
+		}
+		return ret;
+	}();
+
+	uint8_t const *data = reinterpret_cast< uint8_t const * >(data_);
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+ChunkReader::ChunkReader(char const *begin, char const *end_, std::string const &name_, bool verify_) : end(begin), name(name_), verify(verify_) {
+	assert(begin <= end_);
+
+	struct ChunkHeader {
+		char magic[4];
+		uint32_t size;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	//list every chunk (only the headers are read):
+	for (char const *at = begin; at != end_; ) {
+		ChunkHeader header;
+		if (size_t(end_ - at) < sizeof(header)) {
+			throw std::runtime_error("Failed to read chunk header in '" + name + "'.");
+		}
+		std::memcpy(&header, at, sizeof(header));
+		if (size_t(end_ - at) - sizeof(header) < header.size) {
+			throw std::runtime_error("Chunk '" + std::string(header.magic, 4) + "' in '" + name + "' runs past the end of the file.");
+		}
+		Chunk chunk;
+		std::memcpy(chunk.magic, header.magic, 4);
+		chunk.size = header.size;
+		chunk.data = at + sizeof(header);
+		chunks.emplace_back(chunk);
+		at = chunk.data + chunk.size;
+	}
+
+	//a last "crc0" chunk holds the checksums of the others:
+	if (!chunks.empty() && chunks.back().tag() == "crc0") {
+		Chunk crc0 = chunks.back();
+		chunks.pop_back();
+		if (crc0.size != chunks.size() * sizeof(ChunkChecksum)) {
+			throw std::runtime_error("Checksum chunk in '" + name + "' doesn't match the chunks before it.");
+		}
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			ChunkChecksum checksum;
+			std::memcpy(&checksum, crc0.data + i * sizeof(ChunkChecksum), sizeof(ChunkChecksum));
+			if (std::memcmp(checksum.magic, chunks[i].magic, 4) != 0) {
+				throw std::runtime_error("Checksum chunk in '" + name + "' doesn't match the chunks before it.");
+			}
+			chunks[i].crc32 = checksum.crc32;
+			chunks[i].has_crc32 = true;
+		}
+	}
+
+	if (!chunks.empty()) end = chunks.back().data + chunks.back().size;
+}
+
+ChunkReader::Chunk const *ChunkReader::find(std::string_view magic) const {
+	assert(magic.size() == 4);
+	for (auto const &chunk : chunks) {
+		if (chunk.tag() == magic) return &chunk;
+	}
+	return nullptr;
+}
+
+ChunkReader::Chunk const &ChunkReader::get(std::string_view magic) const {
+	Chunk const *chunk = find(magic);
+	if (!chunk) {
+		throw std::runtime_error("Expected a '" + std::string(magic) + "' chunk in '" + name + "'.");
+	}
+	return *chunk;
+}
+
+void ChunkReader::check(Chunk const &chunk) const {
+	if (!verify || !chunk.has_crc32) return;
+	if (crc32(chunk.data, chunk.size) != chunk.crc32) {
+		throw std::runtime_error("Chunk '" + std::string(chunk.tag()) + "' in '" + name + "' fails its checksum (the file is damaged or was being written).");
+	}
+}
+
+void ChunkWriter::write(std::string_view magic, void const *data, size_t size) {
+	assert(magic.size() == 4);
+	if (size > 0xffffffffU) {
+		throw std::runtime_error("Chunk '" + std::string(magic) + "' is too large (" + std::to_string(size) + " bytes).");
+	}
+
+	struct ChunkHeader {
+		char magic[4];
+		uint32_t size;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+	ChunkHeader header;
+	std::memcpy(header.magic, magic.data(), 4);
+	header.size = uint32_t(size);
+
+	to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	to.write(reinterpret_cast< char const * >(data), size);
+
+	if (checksums) {
+		ChunkChecksum checksum;
+		std::memcpy(checksum.magic, magic.data(), 4);
+		checksum.crc32 = crc32(data, size);
+		written.emplace_back(checksum);
+	}
+}
+
+void ChunkWriter::finish() {
+	if (!checksums) return;
+	std::vector< ChunkChecksum > list;
+	list.swap(written);
+	checksums = false; //(so the checksum chunk isn't listed, and finish() does nothing if called again)
+	write("crc0", list);
+}
@@ -1,16 +1,142 @@
 #pragma once
 
+#include "MappedFile.hpp"
+
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 
-//helper function that reads an array of structures preceded by a simple header:
-//Expected format:
+//Chunk files are a sequence of chunks, each an array of structures preceded by a simple header:
 // |ma|gi|c.|..| <-- four byte "magic number"
 // |sz|sz|sz|sz| <-- four byte (native endian) size
 // |TT...TT| * (sz/sizeof(TT)) <-- enough T structures to make up sz bytes
+//
+//Files written by ChunkWriter end with a "crc0" chunk holding a ChunkChecksum for each chunk before it,
+// which ChunkReader uses (when present) to check chunks as they are read. To other readers it is just another chunk.
+
+struct ChunkChecksum {
+	char magic[4]; //of the chunk checked
+	uint32_t crc32; //of the chunk's data
+};
+static_assert(sizeof(ChunkChecksum) == 8, "ChunkChecksum is packed.");
+
+//crc-32 (the zlib / IEEE 802.3 one) of 'size' bytes, continuing from 'crc':
+uint32_t crc32(void const *data, size_t size, uint32_t crc = 0);
+
+//A ChunkReader lists the chunks in memory (usually a MappedFile) without touching their data,
+// then hands out chunks by magic number, skipping any it isn't asked for:
+// in place (so only the pages of chunks actually used are read from disk), or copied into caller memory.
+// (the memory is used in place, so must outlive the reader and anything viewed through it)
+struct ChunkReader {
+	//list the chunks in [begin,end), named 'name' in error messages; throws on malformed chunk headers:
+	// with 'verify', chunks are checked against the file's checksums (if it has any) whenever they are read.
+	ChunkReader(char const *begin, char const *end_, std::string const &name_, bool verify_ = true);
+	explicit ChunkReader(MappedFile const &file, bool verify_ = true) : ChunkReader(file.begin(), file.end(), file.filename, verify_) { }
+
+	struct Chunk {
+		char magic[4];
+		uint32_t size; //in bytes
+		char const *data;
+		uint32_t crc32 = 0;
+		bool has_crc32 = false;
+		std::string_view tag() const { return std::string_view(magic, 4); }
+	};
+	std::vector< Chunk > chunks; //in file order (not counting the checksum chunk)
+	char const *end = nullptr; //end of the last of 'chunks' (where the checksum chunk, if any, begins)
+	std::string name;
+	bool verify = true;
+
+	//first chunk with 'magic' (or nullptr if there isn't one):
+	Chunk const *find(std::string_view magic) const;
+	//..or throw if there isn't one:
+	Chunk const &get(std::string_view magic) const;
+
+	//throw if 'chunk' fails its checksum (does nothing if it has none or verify is off):
+	void check(Chunk const &chunk) const;
+
+	//number of T's in the chunk (throws if its size isn't a multiple of sizeof(T)):
+	template< typename T >
+	size_t count(Chunk const &chunk) const {
+		if (chunk.size % sizeof(T) != 0) {
+			throw std::runtime_error("Size of chunk '" + std::string(chunk.tag()) + "' in '" + name + "' not divisible by element size");
+		}
+		return chunk.size / sizeof(T);
+	}
+
+	//the chunk's T's, in place (throws if the data isn't aligned for T where it sits):
+	template< typename T >
+	T const *view(Chunk const &chunk, size_t *count_) const {
+		assert(count_);
+		*count_ = count< T >(chunk);
+		if (reinterpret_cast< uintptr_t >(chunk.data) % alignof(T) != 0) {
+			throw std::runtime_error("Chunk '" + std::string(chunk.tag()) + "' in '" + name + "' is not aligned for its element type.");
+		}
+		check(chunk);
+		return reinterpret_cast< T const * >(chunk.data);
+	}
 
+	//copy the chunk's T's into caller memory with room for exactly 'count_' of them (nothing is initialized first):
+	template< typename T >
+	void read(Chunk const &chunk, T *to, size_t count_) const {
+		if (count< T >(chunk) != count_) {
+			throw std::runtime_error("Chunk '" + std::string(chunk.tag()) + "' in '" + name + "' has " + std::to_string(count< T >(chunk)) + " entries, expecting " + std::to_string(count_) + ".");
+		}
+		check(chunk);
+		if (chunk.size) std::memcpy(to, chunk.data, chunk.size);
+	}
+
+	//..or into a vector (replacing its contents; any alignment):
+	// entries are copied straight from the chunk into reserved space, so the vector is never value-initialized first.
+	template< typename T >
+	void read(Chunk const &chunk, std::vector< T > *to) const {
+		static_assert(std::is_trivially_copyable< T >::value, "chunk entries are copied as bytes");
+		assert(to);
+		size_t count_ = count< T >(chunk);
+		check(chunk);
+		to->clear();
+		to->reserve(count_);
+		if (reinterpret_cast< uintptr_t >(chunk.data) % alignof(T) == 0) {
+			T const *from = reinterpret_cast< T const * >(chunk.data);
+			to->insert(to->end(), from, from + count_);
+		} else {
+			for (size_t i = 0; i < count_; ++i) {
+				T entry;
+				std::memcpy(&entry, chunk.data + i * sizeof(T), sizeof(T));
+				to->emplace_back(entry);
+			}
+		}
+	}
+};
+
+//A ChunkWriter writes chunks to a stream and (with 'checksums') keeps a checksum of each, for finish() to write:
+struct ChunkWriter {
+	explicit ChunkWriter(std::ostream &to_, bool checksums_ = true) : to(to_), checksums(checksums_) { }
+
+	void write(std::string_view magic, void const *data, size_t size);
+
+	template< typename T >
+	void write(std::string_view magic, std::vector< T > const &from) {
+		write(magic, from.data(), from.size() * sizeof(T));
+	}
+
+	//write the "crc0" chunk (if keeping checksums); call once, after the last chunk:
+	void finish();
+
+	std::ostream &to;
+	bool checksums;
+	std::vector< ChunkChecksum > written;
+};
+
+//The original helpers, for reading and writing chunks one after another through streams
+// (e.g., in Scene::load_extra, which gets a stream of the chunks after a scene's own):
+
+//helper function that reads an array of structures preceded by a simple header:
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *to_) {
 	assert(to_);
@@ -40,7 +166,6 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	}
 }
 
-
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
 void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_) {
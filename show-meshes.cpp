@@ -170,8 +170,8 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
-			Mode::current->draw(drawable_size);
+			//(update above is variable-step, so state is current: alpha = 1)
+			Mode::current->draw(drawable_size, 1.0f);
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
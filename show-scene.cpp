@@ -4,6 +4,7 @@
 #include "GL.hpp"
 #include "load_save_png.hpp"
 #include "ShowSceneProgram.hpp"
+#include "HeadlessGL.hpp"
 
 #include <SDL.h>
 
@@ -12,6 +13,7 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <cstdlib>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -19,60 +21,96 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
-	//------------  initialization ------------
+	//------------  command line ------------
 
-	//Initialize SDL library:
-	SDL_Init(SDL_INIT_VIDEO);
-
-	//Ask for an OpenGL context version 3.3, core profile, enable debug:
-	SDL_GL_ResetAttributes();
-	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-
-	//create window:
-	SDL_Window *window = SDL_CreateWindow(
-		"scene viewer",
-		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-		800, 800,
-		SDL_WINDOW_OPENGL
-		| SDL_WINDOW_RESIZABLE //uncomment to allow resizing
-		| SDL_WINDOW_ALLOW_HIGHDPI //uncomment for full resolution on high-DPI screens
-	);
-
-	//prevent exceedingly tiny windows when resizing:
-	SDL_SetWindowMinimumSize(window, 100, 100);
-
-	if (!window) {
-		std::cerr << "Error creating SDL window: " << SDL_GetError() << std::endl;
-		return 1;
+	bool usage = false;
+	std::string scene_file;
+	std::string meshes_file;
+	uint32_t headless_frames = 0; //if non-zero, benchmark this many frames offscreen instead of opening a window
+	{
+		std::vector< std::string > positional;
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--headless" && i + 1 < argc) {
+				headless_frames = uint32_t(std::max(1, std::atoi(argv[i+1])));
+				i += 1;
+			} else {
+				positional.emplace_back(arg);
+			}
+		}
+		if (positional.size() == 1) {
+			scene_file = positional[0];
+		} else if (positional.size() == 2) {
+			scene_file = positional[0];
+			meshes_file = positional[1];
+		} else {
+			usage = true;
+		}
 	}
 
-	//Create OpenGL context:
-	SDL_GLContext context = SDL_GL_CreateContext(window);
+	//------------  initialization ------------
 
-	if (!context) {
-		SDL_DestroyWindow(window);
-		std::cerr << "Error creating OpenGL context: " << SDL_GetError() << std::endl;
-		return 1;
-	}
+	SDL_Window *window = nullptr;
+	SDL_GLContext context = nullptr;
+	std::unique_ptr< HeadlessGL > headless;
+
+	if (headless_frames) {
+		//offscreen context + framebuffer; no SDL at all:
+		headless.reset(new HeadlessGL(glm::uvec2(800, 800)));
+	} else {
+		//Initialize SDL library:
+		SDL_Init(SDL_INIT_VIDEO);
+
+		//Ask for an OpenGL context version 3.3, core profile, enable debug:
+		SDL_GL_ResetAttributes();
+		SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+		SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+		//create window:
+		window = SDL_CreateWindow(
+			"scene viewer",
+			SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			800, 800,
+			SDL_WINDOW_OPENGL
+			| SDL_WINDOW_RESIZABLE //uncomment to allow resizing
+			| SDL_WINDOW_ALLOW_HIGHDPI //uncomment for full resolution on high-DPI screens
+		);
+
+		//prevent exceedingly tiny windows when resizing:
+		SDL_SetWindowMinimumSize(window, 100, 100);
+
+		if (!window) {
+			std::cerr << "Error creating SDL window: " << SDL_GetError() << std::endl;
+			return 1;
+		}
 
-	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
-	init_GL();
+		//Create OpenGL context:
+		context = SDL_GL_CreateContext(window);
 
-	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
-		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
-		if (SDL_GL_SetSwapInterval(1) != 0) {
-			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
+		if (!context) {
+			SDL_DestroyWindow(window);
+			std::cerr << "Error creating OpenGL context: " << SDL_GetError() << std::endl;
+			return 1;
+		}
+
+		//On windows, load OpenGL entrypoints: (does nothing on other platforms)
+		init_GL();
+
+		//Set VSYNC + Late Swap (prevents crazy FPS):
+		if (SDL_GL_SetSwapInterval(-1) != 0) {
+			std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
+			if (SDL_GL_SetSwapInterval(1) != 0) {
+				std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
+			}
 		}
 	}
 
@@ -80,17 +118,6 @@ int main(int argc, char **argv) {
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
-	bool usage = false;
-	std::string scene_file;
-	std::string meshes_file;
-	if (argc == 2) {
-		scene_file = argv[1];
-	} else if (argc == 3) {
-		scene_file = argv[1];
-		meshes_file = argv[2];
-	} else {
-		usage = true;
-	}
 	MeshBuffer *buffer = nullptr;
 	GLuint buffer_vao = 0;
 	if (meshes_file != "") {
@@ -120,6 +147,13 @@ int main(int argc, char **argv) {
 				drawable.pipeline.type = mesh.type;
 				drawable.pipeline.start = mesh.start;
 				drawable.pipeline.count = mesh.count;
+				drawable.bounding_sphere = mesh.bounding_sphere();
+				drawable.lod_count = std::min(mesh.lod_count, uint32_t(Scene::Drawable::MaxLODs));
+				for (uint32_t l = 0; l < drawable.lod_count; ++l) {
+					drawable.lods[l].start = mesh.lods[l].start;
+					drawable.lods[l].count = mesh.lods[l].count;
+					drawable.lods[l].error = mesh.lods[l].error;
+				}
 
 			});
 		} catch (std::exception &e) {
@@ -132,7 +166,7 @@ int main(int argc, char **argv) {
 		usage = true;
 	}
 	if (usage) {
-		std::cerr << "Usage:\n\t" << argv[0] << " <path/to/scene.scene> [path/to/meshes.pnct]" << std::endl;
+		std::cerr << "Usage:\n\t" << argv[0] << " [--headless <frames>] <path/to/scene.scene> [path/to/meshes.pnct]" << std::endl;
 		return 1;
 	}
 	std::cout << "Showing scene from '" << scene_file << "' with";
@@ -143,6 +177,29 @@ int main(int argc, char **argv) {
 	}
 	Mode::set_current(std::make_shared< ShowSceneMode >(*scene));
 
+	if (headless) {
+		//------------ headless benchmark ------------
+		//draw from the scene's own camera if it has one, otherwise from the viewer's default camera:
+		Scene::Camera *camera = (scene->cameras.empty() ? nullptr : &scene->cameras.front());
+		if (camera) camera->aspect = float(headless->size.x) / float(headless->size.y);
+
+		benchmark_frames(10, headless_frames, [&](){
+			if (camera) {
+				glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+				glClearDepth(1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glEnable(GL_DEPTH_TEST);
+				glDepthFunc(GL_LESS);
+				scene->draw(*camera);
+			} else {
+				Mode::current->draw(headless->size, 1.0f);
+			}
+		});
+
+		Mode::set_current(nullptr);
+		return 0;
+	}
+
 	//------------ main loop ------------
 
 	//this inline function will be called whenever the window is resized,
@@ -212,8 +269,8 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
-			Mode::current->draw(drawable_size);
+			//(update above is variable-step, so state is current: alpha = 1)
+			Mode::current->draw(drawable_size, 1.0f);
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
@@ -0,0 +1,227 @@
+//simplify-meshes adds coarser levels of detail to a .pnct mesh file (as an optional "lod0" chunk; see MeshBuffer::read).
+//
+// Levels are made by vertex clustering: vertices are snapped to the average position of the grid cell
+// they fall in, and triangles that collapse (two corners in one cell) or duplicate another are dropped.
+// Each level doubles the cell size (starting at 1/32 of the mesh's bounding box diagonal) and records
+// how far any vertex moved, which Scene::update_lods uses to pick levels by on-screen error.
+
+#include "Jobs.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//same layout as MeshBuffer::read's Vertex:
+struct Vertex {
+	float Position[3];
+	float Normal[3];
+	uint8_t Color[4];
+	float TexCoord[2];
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct LODEntry {
+	uint32_t mesh; //index of idx0 entry
+	uint32_t vertex_begin, vertex_end;
+	float error;
+};
+static_assert(sizeof(LODEntry) == 16, "LOD entry should be packed");
+
+//one level of detail of a mesh:
+struct Level {
+	std::vector< Vertex > vertices;
+	float error = 0.0f; //farthest any vertex moved
+};
+
+//coarser levels of a triangle list (finest first), each removing at least 'min_reduction' of the previous level's triangles:
+static std::vector< Level > simplify(std::vector< Vertex > const &mesh, uint32_t max_levels, float min_reduction) {
+	std::vector< Level > levels;
+	if (mesh.size() < 3) return levels;
+
+	float min[3] = { INFINITY, INFINITY, INFINITY };
+	float max[3] = {-INFINITY,-INFINITY,-INFINITY };
+	for (auto const &v : mesh) {
+		for (uint32_t c = 0; c < 3; ++c) {
+			min[c] = std::min(min[c], v.Position[c]);
+			max[c] = std::max(max[c], v.Position[c]);
+		}
+	}
+	float diagonal = std::sqrt((max[0]-min[0])*(max[0]-min[0]) + (max[1]-min[1])*(max[1]-min[1]) + (max[2]-min[2])*(max[2]-min[2]));
+	if (!(diagonal > 0.0f)) return levels;
+
+	uint32_t previous_triangles = uint32_t(mesh.size() / 3);
+	float previous_error = 0.0f;
+	for (uint32_t level = 1; level <= max_levels; ++level) {
+		float cell = diagonal * float(1 << level) / 64.0f;
+
+		//cluster vertices by grid cell:
+		auto cell_of = [&](Vertex const &v) {
+			std::array< int32_t, 3 > key;
+			for (uint32_t c = 0; c < 3; ++c) key[c] = int32_t(std::floor((v.Position[c] - min[c]) / cell));
+			return (uint64_t(uint32_t(key[0]) & 0x1fffff) << 42) | (uint64_t(uint32_t(key[1]) & 0x1fffff) << 21) | uint64_t(uint32_t(key[2]) & 0x1fffff);
+		};
+		struct Cluster {
+			double sum[3] = {0.0, 0.0, 0.0};
+			uint32_t count = 0;
+			float average[3] = {0.0f, 0.0f, 0.0f};
+		};
+		std::unordered_map< uint64_t, Cluster > clusters;
+		std::vector< uint64_t > vertex_cells(mesh.size());
+		for (uint32_t i = 0; i < mesh.size(); ++i) {
+			vertex_cells[i] = cell_of(mesh[i]);
+			Cluster &cluster = clusters[vertex_cells[i]];
+			for (uint32_t c = 0; c < 3; ++c) cluster.sum[c] += mesh[i].Position[c];
+			cluster.count += 1;
+		}
+		for (auto &[key, cluster] : clusters) {
+			for (uint32_t c = 0; c < 3; ++c) cluster.average[c] = float(cluster.sum[c] / cluster.count);
+		}
+
+		//how far any vertex moves (never less than the finer levels):
+		float error = previous_error;
+		for (uint32_t i = 0; i < mesh.size(); ++i) {
+			Cluster const &cluster = clusters.at(vertex_cells[i]);
+			float d2 = 0.0f;
+			for (uint32_t c = 0; c < 3; ++c) d2 += (mesh[i].Position[c] - cluster.average[c]) * (mesh[i].Position[c] - cluster.average[c]);
+			error = std::max(error, std::sqrt(d2));
+		}
+
+		//keep triangles whose corners land in three different cells (once per set of cells):
+		std::vector< Vertex > simplified;
+		std::set< std::array< uint64_t, 3 > > seen;
+		for (uint32_t t = 0; t + 2 < mesh.size(); t += 3) {
+			std::array< uint64_t, 3 > cells = {vertex_cells[t], vertex_cells[t+1], vertex_cells[t+2]};
+			if (cells[0] == cells[1] || cells[1] == cells[2] || cells[2] == cells[0]) continue;
+			//(rotate so the smallest cell is first; keeps winding while matching repeats)
+			while (cells[0] > cells[1] || cells[0] > cells[2]) std::rotate(cells.begin(), cells.begin() + 1, cells.end());
+			if (!seen.insert(cells).second) continue;
+			for (uint32_t corner = 0; corner < 3; ++corner) {
+				Vertex v = mesh[t + corner];
+				Cluster const &cluster = clusters.at(vertex_cells[t + corner]);
+				for (uint32_t c = 0; c < 3; ++c) v.Position[c] = cluster.average[c];
+				simplified.emplace_back(v);
+			}
+		}
+
+		uint32_t triangles = uint32_t(simplified.size() / 3);
+		if (triangles == 0 || float(triangles) > (1.0f - min_reduction) * float(previous_triangles)) break;
+
+		levels.emplace_back();
+		levels.back().vertices = std::move(simplified);
+		levels.back().error = error;
+
+		previous_triangles = triangles;
+		previous_error = error;
+	}
+	return levels;
+}
+
+int main(int argc, char **argv) {
+	uint32_t max_levels = 4; //(the most MeshBuffer keeps per mesh)
+	float min_reduction = 0.1f; //stop adding levels once a level removes less than this fraction of the previous level's triangles
+
+	std::vector< std::string > positional;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--levels" && i + 1 < argc) {
+			max_levels = uint32_t(std::min(4, std::max(1, std::atoi(argv[i+1]))));
+			i += 1;
+		} else {
+			positional.emplace_back(arg);
+		}
+	}
+	if (positional.size() != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--levels <1-4>] <in.pnct> <out.pnct>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = positional[0];
+	std::string out_filename = positional[1];
+
+	try {
+		std::vector< Vertex > data;
+		std::vector< char > strings;
+		std::vector< IndexEntry > index;
+		{ //(copied out and unmapped before writing, since the output may replace the input)
+			MappedFile in(in_filename);
+			ChunkReader chunks(in);
+			chunks.read(chunks.get("pnct"), &data);
+			chunks.read(chunks.get("str0"), &strings);
+			chunks.read(chunks.get("idx0"), &index);
+			//(any existing lod0 chunk is ignored and its levels rebuilt)
+		}
+
+		//drop vertices only used by previous levels of detail (which are stored after all the meshes):
+		uint32_t used = 0;
+		for (auto const &entry : index) {
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= data.size())) {
+				throw std::runtime_error("index entry has out-of-range vertex start/count");
+			}
+			used = std::max(used, entry.vertex_end);
+		}
+		data.resize(used);
+
+		//simplify meshes in parallel (each is independent):
+		std::vector< std::vector< Level > > mesh_levels(index.size());
+		Jobs::parallel_for(uint32_t(index.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t m = begin; m < end; ++m) {
+				IndexEntry const &entry = index[m];
+				uint32_t count = (entry.vertex_end - entry.vertex_begin) / 3 * 3; //(triangles only)
+				std::vector< Vertex > mesh(data.begin() + entry.vertex_begin, data.begin() + entry.vertex_begin + count);
+				mesh_levels[m] = simplify(mesh, max_levels, min_reduction);
+			}
+		});
+
+		//append the levels after the meshes, in mesh order:
+		std::vector< LODEntry > lods;
+		std::vector< uint32_t > level_triangles(max_levels + 1, 0);
+		for (uint32_t m = 0; m < index.size(); ++m) {
+			level_triangles[0] += (index[m].vertex_end - index[m].vertex_begin) / 3;
+			for (uint32_t l = 0; l < mesh_levels[m].size(); ++l) {
+				Level const &level = mesh_levels[m][l];
+				LODEntry lod;
+				lod.mesh = m;
+				lod.vertex_begin = uint32_t(data.size());
+				data.insert(data.end(), level.vertices.begin(), level.vertices.end());
+				lod.vertex_end = uint32_t(data.size());
+				lod.error = level.error;
+				lods.emplace_back(lod);
+				level_triangles[l + 1] += uint32_t(level.vertices.size() / 3);
+			}
+		}
+
+		std::ofstream out(out_filename, std::ios::binary);
+		ChunkWriter writer(out);
+		writer.write("pnct", data);
+		writer.write("str0", strings);
+		writer.write("idx0", index);
+		writer.write("lod0", lods);
+		writer.finish();
+		if (!out) throw std::runtime_error("Failed to write '" + out_filename + "'.");
+
+		std::cout << "Wrote " << index.size() << " meshes with " << lods.size() << " levels of detail to '" << out_filename << "'; triangles by level:";
+		for (uint32_t level = 0; level <= max_levels; ++level) {
+			std::cout << " " << level_triangles[level];
+		}
+		std::cout << " (levels are only added where they remove at least " << int(min_reduction * 100.0f) << "%)" << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}